@@ -171,18 +171,13 @@ public:
 
   /// count - Returns the number of bits which are set.
   size_type count() const {
-    unsigned NumBits = 0;
-    for (unsigned i = 0; i < NumBitWords(size()); ++i)
-      NumBits += countPopulation(Bits[i]);
-    return NumBits;
+    return countWords(Bits.data(), NumBitWords(size()));
   }
 
   /// any - Returns true if any bit is set.
   bool any() const {
-    for (unsigned i = 0; i < NumBitWords(size()); ++i)
-      if (Bits[i] != 0)
-        return true;
-    return false;
+    unsigned NumWords = NumBitWords(size());
+    return findNonZeroWord(Bits.data(), 0, NumWords) != NumWords;
   }
 
   /// all - Returns true if all bits are set.
@@ -212,23 +207,24 @@ public:
 
     unsigned FirstWord = Begin / BITWORD_SIZE;
     unsigned LastWord = (End - 1) / BITWORD_SIZE;
+    unsigned FirstBit = Begin % BITWORD_SIZE;
+    unsigned LastBit = (End - 1) % BITWORD_SIZE;
 
-    // Check subsequent words.
-    for (unsigned i = FirstWord; i <= LastWord; ++i) {
-      BitWord Copy = Bits[i];
-
-      if (i == FirstWord) {
-        unsigned FirstBit = Begin % BITWORD_SIZE;
-        Copy &= maskTrailingZeros<BitWord>(FirstBit);
-      }
-
-      if (i == LastWord) {
-        unsigned LastBit = (End - 1) % BITWORD_SIZE;
-        Copy &= maskTrailingOnes<BitWord>(LastBit + 1);
-      }
+    BitWord Copy = Bits[FirstWord] & maskTrailingZeros<BitWord>(FirstBit);
+    if (FirstWord != LastWord) {
       if (Copy != 0)
-        return i * BITWORD_SIZE + countTrailingZeros(Copy);
+        return FirstWord * BITWORD_SIZE + countTrailingZeros(Copy);
+
+      // Skip over the whole words in between.
+      unsigned i = findNonZeroWord(Bits.data(), FirstWord + 1, LastWord);
+      if (i != LastWord)
+        return i * BITWORD_SIZE + countTrailingZeros(Bits[i]);
+      Copy = Bits[LastWord];
     }
+
+    Copy &= maskTrailingOnes<BitWord>(LastBit + 1);
+    if (Copy != 0)
+      return LastWord * BITWORD_SIZE + countTrailingZeros(Copy);
     return -1;
   }
 
@@ -507,32 +503,24 @@ public:
   bool anyCommon(const BitVector &RHS) const {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    for (unsigned i = 0, e = std::min(ThisWords, RHSWords); i != e; ++i)
-      if (Bits[i] & RHS.Bits[i])
-        return true;
-    return false;
+    return anyCommonWords<false>(Bits.data(), RHS.Bits.data(),
+                                 std::min(ThisWords, RHSWords));
   }
 
   // Comparison operators.
   bool operator==(const BitVector &RHS) const {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
-      if (Bits[i] != RHS.Bits[i])
-        return false;
+    unsigned CommonWords = std::min(ThisWords, RHSWords);
+    if (!equalWords(Bits.data(), RHS.Bits.data(), CommonWords))
+      return false;
 
     // Verify that any extra words are all zeros.
-    if (i != ThisWords) {
-      for (; i != ThisWords; ++i)
-        if (Bits[i])
-          return false;
-    } else if (i != RHSWords) {
-      for (; i != RHSWords; ++i)
-        if (RHS.Bits[i])
-          return false;
-    }
-    return true;
+    if (CommonWords != ThisWords)
+      return findNonZeroWord(Bits.data(), CommonWords, ThisWords) ==
+             ThisWords;
+    return findNonZeroWord(RHS.Bits.data(), CommonWords, RHSWords) ==
+           RHSWords;
   }
 
   bool operator!=(const BitVector &RHS) const {
@@ -543,15 +531,14 @@ public:
   BitVector &operator&=(const BitVector &RHS) {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
-      Bits[i] &= RHS.Bits[i];
+    unsigned CommonWords = std::min(ThisWords, RHSWords);
+    combineWords(Bits.data(), RHS.Bits.data(), CommonWords,
+                 [](BitWord L, BitWord R) { return L & R; });
 
     // Any bits that are just in this bitvector become zero, because they aren't
     // in the RHS bit vector.  Any words only in RHS are ignored because they
     // are already zero in the LHS.
-    for (; i != ThisWords; ++i)
-      Bits[i] = 0;
+    std::fill(Bits.begin() + CommonWords, Bits.begin() + ThisWords, 0);
 
     return *this;
   }
@@ -560,9 +547,8 @@ public:
   BitVector &reset(const BitVector &RHS) {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
-      Bits[i] &= ~RHS.Bits[i];
+    combineWords(Bits.data(), RHS.Bits.data(), std::min(ThisWords, RHSWords),
+                 [](BitWord L, BitWord R) { return L & ~R; });
     return *this;
   }
 
@@ -571,31 +557,25 @@ public:
   bool test(const BitVector &RHS) const {
     unsigned ThisWords = NumBitWords(size());
     unsigned RHSWords  = NumBitWords(RHS.size());
-    unsigned i;
-    for (i = 0; i != std::min(ThisWords, RHSWords); ++i)
-      if ((Bits[i] & ~RHS.Bits[i]) != 0)
-        return true;
-
-    for (; i != ThisWords ; ++i)
-      if (Bits[i] != 0)
-        return true;
-
-    return false;
+    unsigned CommonWords = std::min(ThisWords, RHSWords);
+    if (anyCommonWords<true>(Bits.data(), RHS.Bits.data(), CommonWords))
+      return true;
+    return findNonZeroWord(Bits.data(), CommonWords, ThisWords) != ThisWords;
   }
 
   BitVector &operator|=(const BitVector &RHS) {
     if (size() < RHS.size())
       resize(RHS.size());
-    for (size_t i = 0, e = NumBitWords(RHS.size()); i != e; ++i)
-      Bits[i] |= RHS.Bits[i];
+    combineWords(Bits.data(), RHS.Bits.data(), NumBitWords(RHS.size()),
+                 [](BitWord L, BitWord R) { return L | R; });
     return *this;
   }
 
   BitVector &operator^=(const BitVector &RHS) {
     if (size() < RHS.size())
       resize(RHS.size());
-    for (size_t i = 0, e = NumBitWords(RHS.size()); i != e; ++i)
-      Bits[i] ^= RHS.Bits[i];
+    combineWords(Bits.data(), RHS.Bits.data(), NumBitWords(RHS.size()),
+                 [](BitWord L, BitWord R) { return L ^ R; });
     return *this;
   }
 
@@ -779,6 +759,84 @@ public:
   }
 
 private:
+  //===--------------------------------------------------------------------===//
+  // Word array kernels.
+  //===--------------------------------------------------------------------===//
+  //
+  // The whole-vector operations above are built on these. They work through
+  // the words in blocks of WordsPerBlock with no branches inside a block, so
+  // the compiler can turn each block into vector instructions as wide as the
+  // target has, and the scans that stop early only branch once per block.
+
+  enum { WordsPerBlock = 4 };
+
+  /// Returns the index of the first nonzero word in Words[Begin, End), or End
+  /// if there is none.
+  static unsigned findNonZeroWord(const BitWord *Words, unsigned Begin,
+                                  unsigned End) {
+    unsigned i = Begin;
+    for (; End - i >= WordsPerBlock; i += WordsPerBlock) {
+      BitWord Any = 0;
+      for (unsigned j = 0; j != WordsPerBlock; ++j)
+        Any |= Words[i + j];
+      if (Any != 0)
+        break;
+    }
+    for (; i != End; ++i)
+      if (Words[i] != 0)
+        return i;
+    return End;
+  }
+
+  /// Returns true if LHS[i] & RHS[i] (or & ~RHS[i], if InvertRHS) is nonzero
+  /// for some i < NumWords.
+  template <bool InvertRHS>
+  static bool anyCommonWords(const BitWord *LHS, const BitWord *RHS,
+                             unsigned NumWords) {
+    unsigned i = 0;
+    BitWord Any = 0;
+    for (; NumWords - i >= WordsPerBlock; i += WordsPerBlock) {
+      for (unsigned j = 0; j != WordsPerBlock; ++j)
+        Any |= LHS[i + j] & (InvertRHS ? ~RHS[i + j] : RHS[i + j]);
+      if (Any != 0)
+        return true;
+    }
+    for (; i != NumWords; ++i)
+      Any |= LHS[i] & (InvertRHS ? ~RHS[i] : RHS[i]);
+    return Any != 0;
+  }
+
+  static bool equalWords(const BitWord *LHS, const BitWord *RHS,
+                         unsigned NumWords) {
+    unsigned i = 0;
+    BitWord Diff = 0;
+    for (; NumWords - i >= WordsPerBlock; i += WordsPerBlock) {
+      for (unsigned j = 0; j != WordsPerBlock; ++j)
+        Diff |= LHS[i + j] ^ RHS[i + j];
+      if (Diff != 0)
+        return false;
+    }
+    for (; i != NumWords; ++i)
+      Diff |= LHS[i] ^ RHS[i];
+    return Diff == 0;
+  }
+
+  static unsigned countWords(const BitWord *Words, unsigned NumWords) {
+    unsigned Count = 0;
+    for (unsigned i = 0; i != NumWords; ++i)
+      Count += countPopulation(Words[i]);
+    return Count;
+  }
+
+  /// Dst[i] = Op(Dst[i], Src[i]) for each i < NumWords. Dst and Src may be the
+  /// same array.
+  template <typename OpT>
+  static void combineWords(BitWord *Dst, const BitWord *Src,
+                           unsigned NumWords, OpT Op) {
+    for (size_t i = 0; i != NumWords; ++i)
+      Dst[i] = Op(Dst[i], Src[i]);
+  }
+
   /// Perform a logical left shift of \p Count words by moving everything
   /// \p Count words to the right in memory.
   ///
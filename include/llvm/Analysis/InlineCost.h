@@ -17,8 +17,10 @@
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/IR/PassManager.h"
 #include <cassert>
 #include <climits>
+#include <memory>
 
 namespace llvm {
 class AssumptionCacheTracker;
@@ -178,6 +180,46 @@ InlineParams getInlineParams(unsigned OptLevel, unsigned SizeOptLevel);
 /// and the call/return instruction.
 int getCallsiteCost(CallSite CS, const DataLayout &DL);
 
+/// Walks of a callee's body done by the inline cost analysis, kept for reuse.
+///
+/// Most of the work of computing an inline cost is simulating the callee with
+/// the call site's arguments folded in. That simulation only depends on which
+/// arguments are constants or point into the caller's allocas, and on whether
+/// the caller is recursive, so call sites that agree on those can share it.
+/// The walks stay valid as long as the callee is unchanged.
+class InlineCostCache {
+public:
+  class Impl;
+
+  InlineCostCache();
+  InlineCostCache(InlineCostCache &&Arg);
+  InlineCostCache &operator=(InlineCostCache &&RHS);
+  ~InlineCostCache();
+
+  /// Forgets all walks. Passes that change the callee without going through
+  /// the analysis manager must call this.
+  void clear();
+
+  Impl &getImpl() { return *TheImpl; }
+
+private:
+  std::unique_ptr<Impl> TheImpl;
+};
+
+/// Provides an empty \c InlineCostCache for a function, to be filled in by
+/// \c getInlineCost for call sites that call it. Like any function analysis,
+/// it is invalidated when the function changes.
+class InlineCostCacheAnalysis
+    : public AnalysisInfoMixin<InlineCostCacheAnalysis> {
+  friend AnalysisInfoMixin<InlineCostCacheAnalysis>;
+  static AnalysisKey Key;
+
+public:
+  using Result = InlineCostCache;
+
+  Result run(Function &F, FunctionAnalysisManager &FAM) { return Result(); }
+};
+
 /// Get an InlineCost object representing the cost of inlining this
 /// callsite.
 ///
@@ -188,12 +230,14 @@ int getCallsiteCost(CallSite CS, const DataLayout &DL);
 /// sufficiently low to warrant inlining.
 ///
 /// Also note that calling this function *dynamically* computes the cost of
-/// inlining the callsite. It is an expensive, heavyweight call.
+/// inlining the callsite. It is an expensive, heavyweight call. Passing the
+/// callee's \p CalleeCache lets it reuse the walk of an earlier call site.
 InlineCost getInlineCost(
     CallSite CS, const InlineParams &Params, TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE = nullptr);
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE = nullptr,
+    InlineCostCache *CalleeCache = nullptr);
 
 /// Get an InlineCost with the callee explicitly specified.
 /// This allows you to calculate the cost of inlining a function via a
@@ -205,7 +249,8 @@ getInlineCost(CallSite CS, Function *Callee, const InlineParams &Params,
               TargetTransformInfo &CalleeTTI,
               std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
               Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-              ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE);
+              ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+              InlineCostCache *CalleeCache = nullptr);
 
 /// Minimal filter to detect invalid constructs for inlining.
 bool isInlineViable(Function &Callee);
@@ -65,6 +65,11 @@ struct LoopStandardAnalysisResults {
 /// Enables memory ssa as a dependency for loop passes.
 extern cl::opt<bool> EnableMSSALoopDependency;
 
+/// Size in kilobytes of ScalarEvolution's expression arena beyond which the
+/// loop pass adaptor stops preserving it, so that it is rebuilt from scratch
+/// instead of accumulating dead expressions. Zero disables the reset.
+extern cl::opt<unsigned> SCEVArenaResetThreshold;
+
 /// Extern template declaration for the analysis set for this IR unit.
 extern template class AllAnalysesOn<Loop>;
 
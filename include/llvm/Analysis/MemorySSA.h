@@ -119,6 +119,10 @@ struct DefsOnlyTag {};
 
 } // end namespace MSSAHelpers
 
+/// Set by -verify-memoryssa. Passes that update MemorySSA verify it after each
+/// run when this is set.
+extern bool VerifyMemorySSA;
+
 enum : unsigned {
   // Used to signify what the default invalid ID is for MemoryAccess's
   // getID()
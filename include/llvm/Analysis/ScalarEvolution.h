@@ -788,6 +788,16 @@ public:
   /// recompute is simpler.
   void forgetLoopDispositions(const Loop *L) { LoopDispositions.clear(); }
 
+  /// Return the number of bytes allocated for expressions and predicates.
+  ///
+  /// Expressions are uniqued and live until this object is destroyed, even
+  /// after every cache entry referring to them has been forgotten, so this
+  /// only grows. Pass managers use it to decide when to drop the analysis and
+  /// let it be rebuilt from scratch.
+  size_t getExpressionArenaSize() const {
+    return SCEVAllocator.getTotalMemory();
+  }
+
   /// Determine the minimum number of zero bits that S is guaranteed to end in
   /// (at every loop iteration).  It is, at the same time, the minimum number
   /// of times S is divisible by 2.  For example, given {4,+,8} it returns 2.
@@ -1319,9 +1329,9 @@ private:
     /// value returned by getMax or zero.
     bool isMaxOrZero(ScalarEvolution *SE) const;
 
-    /// Return true if any backedge taken count expressions refer to the given
-    /// subexpression.
-    bool hasOperand(const SCEV *S, ScalarEvolution *SE) const;
+    /// Collect every expression the backedge taken counts refer to, i.e. the
+    /// counts themselves and all of their subexpressions.
+    void getOperands(SmallPtrSetImpl<const SCEV *> &Ops) const;
 
     /// Invalidate this result and free associated memory.
     void clear();
@@ -1335,6 +1345,21 @@ private:
   /// function as they are computed.
   DenseMap<const Loop *, BackedgeTakenInfo> PredicatedBackedgeTakenCounts;
 
+  /// Maps each expression used by a cached backedge-taken count to the loops
+  /// whose count uses it, so that forgetting an expression does not need to
+  /// search every cached count. The int is set for entries of
+  /// PredicatedBackedgeTakenCounts.
+  DenseMap<const SCEV *, SmallPtrSet<PointerIntPair<const Loop *, 1, bool>, 2>>
+      BECountUsers;
+
+  /// Record that the backedge-taken count \p BTI just cached for \p L uses
+  /// its subexpressions.
+  void addBECountUsers(const Loop *L, const BackedgeTakenInfo &BTI,
+                       bool Predicated);
+
+  /// Erase the cached (predicated) backedge-taken count of \p L, if any.
+  void eraseBackedgeTakenInfo(const Loop *L, bool Predicated);
+
   /// This map contains entries for all of the PHI instructions that we
   /// attempt to compute constant evolutions for.  This allows us to avoid
   /// potentially expensive recomputation of these properties.  An instruction
@@ -0,0 +1,171 @@
+//===- llvm/CodeGen/BitVectorDataflow.h - Gen/kill dataflow -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file
+/// A solver for the union-based gen/kill dataflow problems that liveness-style
+/// analyses reduce to:
+///
+///   In(B)  = union of Out(P) over the predecessors P of B
+///   Out(B) = (In(B) - Kill(B)) | Gen(B)
+///
+/// For backward problems the roles of predecessors and successors are swapped,
+/// so In is the set at the end of the block and Out the one at its start.
+///
+/// Each bit is one fact (a stack slot, a register, ...), so a block's transfer
+/// function is a handful of whole-word operations over its sets. The blocks
+/// are visited in reverse post-order of the flow, and only blocks whose input
+/// changed are visited again, so an acyclic region settles in one sweep.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_BITVECTORDATAFLOW_H
+#define LLVM_CODEGEN_BITVECTORDATAFLOW_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace llvm {
+
+namespace detail {
+
+/// Out |= (In - Kill) | Gen, using Tmp as scratch space. Returns true if Out
+/// changed.
+inline bool applyGenKill(BitVector &Out, const BitVector &In,
+                         const BitVector &Kill, const BitVector &Gen,
+                         BitVector &Tmp) {
+  Tmp = In;
+  Tmp.reset(Kill);
+  Tmp |= Gen;
+  if (!Tmp.test(Out))
+    return false;
+  Out |= Tmp;
+  return true;
+}
+
+template <unsigned ElementSize>
+bool applyGenKill(SparseBitVector<ElementSize> &Out,
+                  const SparseBitVector<ElementSize> &In,
+                  const SparseBitVector<ElementSize> &Kill,
+                  const SparseBitVector<ElementSize> &Gen,
+                  SparseBitVector<ElementSize> &Tmp) {
+  Tmp.intersectWithComplement(In, Kill);
+  Tmp |= Gen;
+  return Out |= Tmp;
+}
+
+} // end namespace detail
+
+/// Solves a gen/kill problem over the blocks of \p GraphT reachable from its
+/// entry. \p SetT is BitVector or SparseBitVector; the latter suits problems
+/// with many facts of which each block only touches a few.
+///
+/// Clients fill in each block's Gen and Kill sets, call solve(), and read the
+/// In and Out sets back.
+template <typename GraphT, typename SetT = BitVector> class BitVectorDataflow {
+  using GT = GraphTraits<GraphT>;
+
+public:
+  using NodeRef = typename GT::NodeRef;
+
+  /// The sets of one block.
+  struct BlockSets {
+    /// Facts the block establishes.
+    SetT Gen;
+
+    /// Facts the block ends, unless it also establishes them.
+    SetT Kill;
+
+    /// Facts flowing into the block.
+    SetT In;
+
+    /// Facts flowing out of the block.
+    SetT Out;
+  };
+
+  /// Set up a forward or backward problem with all sets empty.
+  explicit BitVectorDataflow(GraphT G, bool Forward = true) {
+    ReversePostOrderTraversal<GraphT> RPOT(G);
+    Blocks.assign(RPOT.begin(), RPOT.end());
+    // Visiting a backward problem in post-order sees a block's successors
+    // before the block, like reverse post-order does for forward problems.
+    if (!Forward)
+      std::reverse(Blocks.begin(), Blocks.end());
+
+    for (unsigned Idx = 0, E = Blocks.size(); Idx != E; ++Idx)
+      Numbering[Blocks[Idx]] = Idx;
+
+    Sets.resize(Blocks.size());
+    Preds.resize(Blocks.size());
+    Succs.resize(Blocks.size());
+    for (unsigned Idx = 0, E = Blocks.size(); Idx != E; ++Idx) {
+      for (NodeRef Child : children<GraphT>(Blocks[Idx])) {
+        unsigned ChildIdx = Numbering.lookup(Child);
+        unsigned From = Forward ? Idx : ChildIdx;
+        unsigned To = Forward ? ChildIdx : Idx;
+        Succs[From].push_back(To);
+        Preds[To].push_back(From);
+      }
+    }
+  }
+
+  /// The blocks of the problem, in the order they are visited.
+  ArrayRef<NodeRef> blocks() const { return Blocks; }
+
+  bool contains(NodeRef N) const { return Numbering.count(N); }
+
+  BlockSets &operator[](NodeRef N) {
+    auto I = Numbering.find(N);
+    assert(I != Numbering.end() && "Block is unreachable from the entry");
+    return Sets[I->second];
+  }
+
+  /// Compute the In and Out sets of every block. Returns the number of sweeps
+  /// over the blocks that it took to reach the fixed point.
+  unsigned solve() {
+    BitVector Pending(Blocks.size(), true);
+    SetT Tmp;
+    unsigned NumSweeps = 0;
+    while (Pending.any()) {
+      ++NumSweeps;
+      // Blocks that become pending later in the order are visited in this
+      // sweep; only those reached through a back edge wait for the next one.
+      for (int Idx = Pending.find_first(); Idx != -1;
+           Idx = Pending.find_next(Idx)) {
+        Pending.reset(Idx);
+        BlockSets &S = Sets[Idx];
+        for (unsigned Pred : Preds[Idx])
+          S.In |= Sets[Pred].Out;
+        if (!detail::applyGenKill(S.Out, S.In, S.Kill, S.Gen, Tmp))
+          continue;
+        for (unsigned Succ : Succs[Idx])
+          Pending.set(Succ);
+      }
+    }
+    return NumSweeps;
+  }
+
+private:
+  std::vector<NodeRef> Blocks;
+  DenseMap<NodeRef, unsigned> Numbering;
+  std::vector<BlockSets> Sets;
+  std::vector<SmallVector<unsigned, 2>> Preds;
+  std::vector<SmallVector<unsigned, 2>> Succs;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_CODEGEN_BITVECTORDATAFLOW_H
@@ -15,8 +15,9 @@
 #define LLVM_EXECUTIONENGINE_ORC_SYMBOLSTRINGPOOL_H
 
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DJB.h"
+#include "llvm/Support/RWMutex.h"
 #include <atomic>
-#include <mutex>
 
 namespace llvm {
 namespace orc {
@@ -24,6 +25,11 @@ namespace orc {
 class SymbolStringPtr;
 
 /// String pool for symbol names used by the JIT.
+///
+/// The pool is split into shards by string hash, each with its own
+/// reader/writer lock, so that threads interning different names rarely touch
+/// the same lock, and threads interning names that are already pooled (the
+/// common case once a JIT'd program is running) share it.
 class SymbolStringPool {
   friend class SymbolStringPtr;
 public:
@@ -42,8 +48,21 @@ private:
   using RefCountType = std::atomic<size_t>;
   using PoolMap = StringMap<RefCountType>;
   using PoolMapEntry = StringMapEntry<RefCountType>;
-  mutable std::mutex PoolMutex;
-  PoolMap Pool;
+
+  struct Shard {
+    mutable sys::RWMutex Mutex;
+    PoolMap Pool;
+  };
+
+  enum { NumShards = 32 };
+
+  Shard &getShard(StringRef S) {
+    // StringMap buckets by the low bits of the same hash, so pick the shard
+    // with the high ones.
+    return Shards[(djbHash(S, 0) >> 24) % NumShards];
+  }
+
+  Shard Shards[NumShards];
 };
 
 /// Pointer to a pooled string representing a symbol name.
@@ -115,30 +134,45 @@ inline bool operator<(const SymbolStringPtr &LHS, const SymbolStringPtr &RHS) {
 inline SymbolStringPool::~SymbolStringPool() {
 #ifndef NDEBUG
   clearDeadEntries();
-  assert(Pool.empty() && "Dangling references at pool destruction time");
+  assert(empty() && "Dangling references at pool destruction time");
 #endif // NDEBUG
 }
 
 inline SymbolStringPtr SymbolStringPool::intern(StringRef S) {
-  std::lock_guard<std::mutex> Lock(PoolMutex);
+  Shard &Sh = getShard(S);
+  {
+    // Entries are only erased under the writer lock, so one found here stays
+    // alive until the returned pointer has taken its reference.
+    sys::ScopedReader Lock(Sh.Mutex);
+    PoolMap::iterator I = Sh.Pool.find(S);
+    if (I != Sh.Pool.end())
+      return SymbolStringPtr(&*I);
+  }
+  sys::ScopedWriter Lock(Sh.Mutex);
   PoolMap::iterator I;
   bool Added;
-  std::tie(I, Added) = Pool.try_emplace(S, 0);
+  std::tie(I, Added) = Sh.Pool.try_emplace(S, 0);
   return SymbolStringPtr(&*I);
 }
 
 inline void SymbolStringPool::clearDeadEntries() {
-  std::lock_guard<std::mutex> Lock(PoolMutex);
-  for (auto I = Pool.begin(), E = Pool.end(); I != E;) {
-    auto Tmp = I++;
-    if (Tmp->second == 0)
-      Pool.erase(Tmp);
+  for (Shard &Sh : Shards) {
+    sys::ScopedWriter Lock(Sh.Mutex);
+    for (auto I = Sh.Pool.begin(), E = Sh.Pool.end(); I != E;) {
+      auto Tmp = I++;
+      if (Tmp->second == 0)
+        Sh.Pool.erase(Tmp);
+    }
   }
 }
 
 inline bool SymbolStringPool::empty() const {
-  std::lock_guard<std::mutex> Lock(PoolMutex);
-  return Pool.empty();
+  for (const Shard &Sh : Shards) {
+    sys::ScopedReader Lock(Sh.Mutex);
+    if (!Sh.Pool.empty())
+      return false;
+  }
+  return true;
 }
 
 } // end namespace orc
@@ -161,6 +161,20 @@ public:
   /// especially in release mode.
   void setDiscardValueNames(bool Discard);
 
+  /// Return true if the context is in concurrent mode. See setConcurrent().
+  bool isConcurrent() const;
+
+  /// Set whether the context is in concurrent mode, in which the state it
+  /// shares between functions (uniqued constants, types, metadata and
+  /// attributes, value names, metadata attachments, value handles, the use
+  /// lists of constants and globals, and the symbol tables and global lists
+  /// of its modules) is guarded by a lock. Only updates are serialized: code
+  /// running concurrently must not read the use lists of constants or
+  /// globals, nor state that other threads may update. See
+  /// ParallelModuleToFunctionPassAdaptor. The mode must only be changed while
+  /// no other thread is using the context.
+  void setConcurrent(bool Concurrent);
+
   /// Whether there is a string map for uniquing debug info
   /// identifiers across the context.  Off by default.
   bool isODRUniquingDebugTypes() const;
@@ -16,9 +16,12 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
+#include <string>
 #include <vector>
 
 //===----------------------------------------------------------------------===//
@@ -92,6 +95,7 @@
 
 namespace llvm {
 template <typename T> class ArrayRef;
+class Function;
 class Module;
 class Pass;
 class StringRef;
@@ -509,6 +513,53 @@ public:
 };
 
 Timer *getPassTimer(Pass *);
+
+/// Records a single run of a pass, from construction to destruction, as an
+/// event in the -time-passes-trace file. The event names the IR unit the pass
+/// ran on, its size in instructions before and after, and the change in the
+/// heap usage of the process. This does nothing unless a trace file was
+/// requested.
+class PassTraceRegion {
+  Pass *P = nullptr;
+  Module *M = nullptr;
+  Function *F = nullptr;
+  BasicBlock *BB = nullptr;
+  Optional<function_ref<unsigned()>> GetSize;
+  SmallVector<Function *, 4> SCC;
+  std::string Target;
+  uint64_t StartMicros;
+  size_t MallocBefore;
+  unsigned SizeBefore;
+
+  void begin(Pass *P);
+  unsigned getSize() const;
+
+public:
+  /// Traces a pass over a whole module.
+  PassTraceRegion(Pass *P, Module &M);
+  /// Traces a pass over a function.
+  PassTraceRegion(Pass *P, Function &F);
+  /// Traces a pass over a basic block.
+  PassTraceRegion(Pass *P, BasicBlock &BB);
+  /// Traces a pass over another part of a function, such as a loop or a
+  /// region, called \p Name. \p GetSize returns its size in instructions,
+  /// and is called before and after the pass, so it must outlive the region.
+  PassTraceRegion(Pass *P, StringRef Name, function_ref<unsigned()> GetSize);
+  /// Traces a pass over a strongly connected component of the call graph.
+  /// The sizes recorded are those of the functions in the component.
+  PassTraceRegion(Pass *P, ArrayRef<Function *> SCC);
+  PassTraceRegion(const PassTraceRegion &) = delete;
+  PassTraceRegion &operator=(const PassTraceRegion &) = delete;
+  ~PassTraceRegion();
+
+  /// Call graph passes may replace the functions they run on. Sets the
+  /// functions the component consists of after the pass, whose size is
+  /// recorded instead.
+  void setSCC(ArrayRef<Function *> NewSCC) {
+    if (P)
+      SCC.assign(NewSCC.begin(), NewSCC.end());
+  }
+};
 }
 
 #endif
@@ -51,6 +51,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <functional>
 #include <iterator>
 #include <list>
 #include <memory>
@@ -1231,6 +1232,69 @@ createModuleToFunctionPassAdaptor(FunctionPassT Pass) {
   return ModuleToFunctionPassAdaptor<FunctionPassT>(std::move(Pass));
 }
 
+/// A module pass that runs a function pipeline over the functions of a module
+/// on several threads.
+///
+/// Each worker thread builds its own function pass manager and function
+/// analysis manager through \c BuildPipeline, so no pass or analysis state is
+/// shared between threads. While the pipeline runs, the module's context is
+/// switched to concurrent mode (see \c LLVMContext::setConcurrent) so that
+/// uniquing constants, types, metadata and names is serialized.
+///
+/// The function passes must obey the function pass contract documented on
+/// \c ModuleToFunctionPassAdaptor. Module analyses are only available through
+/// the \c getCachedResult interface of the outer proxy, exactly as for the
+/// sequential adaptor.
+///
+/// Concurrent mode only serializes writers, so this is not safe for general
+/// pipelines, and it is deliberately not available in textual pipelines. In
+/// particular, passes must not:
+/// - read the use lists of constants or globals (\c hasOneUse on a constant
+///   expression, \c users() of a declaration, ...), which other threads may
+///   be editing;
+/// - create or change declarations shared between functions, such as the
+///   library calls SimplifyLibCalls inserts and annotates;
+/// - use target state that is cached lazily, such as a target machine's
+///   subtarget map.
+/// Value handle callbacks run with the context lock held.
+class ParallelModuleToFunctionPassAdaptor
+    : public PassInfoMixin<ParallelModuleToFunctionPassAdaptor> {
+public:
+  /// Populates a fresh function pass manager and registers the analyses the
+  /// pipeline needs in a fresh function analysis manager. The returned object
+  /// owns any further per-thread state the pipeline refers to (such as a loop
+  /// analysis manager) and is destroyed after both managers.
+  using PipelineBuilderT = std::function<std::shared_ptr<void>(
+      FunctionPassManager &, FunctionAnalysisManager &)>;
+
+  /// \p ThreadCount of zero uses one thread per hardware core.
+  explicit ParallelModuleToFunctionPassAdaptor(PipelineBuilderT BuildPipeline,
+                                               unsigned ThreadCount = 0,
+                                               bool DebugLogging = false)
+      : BuildPipeline(std::move(BuildPipeline)), ThreadCount(ThreadCount),
+        DebugLogging(DebugLogging) {}
+
+  /// Runs the function pipeline across every function in the module.
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  /// Runs a pipeline built by \p BuildPipeline over \p Functions, which must
+  /// be definitions in one module, and returns what each run preserved, in the
+  /// same order. Declarations and globals the passes create, and the use lists
+  /// of the constants they touch, are put in an order that does not depend on
+  /// thread timing afterwards. Nothing cached in the caller's function
+  /// analysis manager is invalidated.
+  static std::vector<PreservedAnalyses>
+  runOnFunctions(ArrayRef<Function *> Functions,
+                 const PipelineBuilderT &BuildPipeline,
+                 ModuleAnalysisManager &AM, unsigned ThreadCount,
+                 bool DebugLogging);
+
+  PipelineBuilderT BuildPipeline;
+  unsigned ThreadCount;
+  bool DebugLogging;
+};
+
 /// A utility pass template to force an analysis result to be available.
 ///
 /// If there are extra arguments at the pass's run level there may also be
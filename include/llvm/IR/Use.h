@@ -91,10 +91,7 @@ public:
 
 private:
   /// Destructor - Only for zap()
-  ~Use() {
-    if (Val)
-      removeFromList();
-  }
+  inline ~Use();
 
   enum PrevPtrTag { zeroDigitTag, oneDigitTag, stopTag, fullStopTag };
 
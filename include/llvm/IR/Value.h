@@ -19,6 +19,8 @@
 #include "llvm/IR/Use.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/Compiler.h"
+#include <atomic>
 #include <cassert>
 #include <iterator>
 #include <memory>
@@ -433,7 +435,42 @@ public:
   unsigned getNumUses() const;
 
   /// This method should only be used by the Use class.
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    if (LLVM_UNLIKELY(isConcurrencyEnabled()) && hasSharedUseList())
+      return addSharedUse(U);
+    U.addToList(&UseList);
+  }
+
+  /// This method should only be used by the Use class.
+  void removeUse(Use &U) {
+    if (LLVM_UNLIKELY(isConcurrencyEnabled()) && hasSharedUseList())
+      return removeSharedUse(U);
+    U.removeFromList();
+  }
+
+private:
+  friend class LLVMContext;
+
+  /// The number of contexts in concurrent mode. While there are none, which
+  /// is the common case, use lists are updated inline without a lock.
+  static std::atomic<unsigned> NumConcurrentContexts;
+
+  static bool isConcurrencyEnabled() {
+    return NumConcurrentContexts.load(std::memory_order_relaxed) != 0;
+  }
+
+  /// Return true if this value is uniqued or global, so that its use list may
+  /// be updated from any function. Such use lists are guarded by the context
+  /// lock when the context is concurrent.
+  bool hasSharedUseList() const {
+    return SubclassID <= ConstantLastVal || SubclassID == MetadataAsValueVal ||
+           SubclassID == InlineAsmVal;
+  }
+
+  void addSharedUse(Use &U);
+  void removeSharedUse(Use &U);
+
+public:
 
   /// Concrete subclass of this.
   ///
@@ -667,8 +704,13 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
   return OS;
 }
 
+Use::~Use() {
+  if (Val)
+    Val->removeUse(*this);
+}
+
 void Use::set(Value *V) {
-  if (Val) removeFromList();
+  if (Val) Val->removeUse(*this);
   Val = V;
   if (V) V->addUse(*this);
 }
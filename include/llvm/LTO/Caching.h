@@ -34,6 +34,22 @@ typedef std::function<void(unsigned Task, std::unique_ptr<MemoryBuffer> MB)>
 Expected<NativeObjectCache> localCache(StringRef CacheDirectoryPath,
                                        AddBufferFn AddBuffer);
 
+/// Create a local file system cache like localCache(), which additionally
+/// keeps an index of its entries in the file "llvmcache.index" within the
+/// cache directory. Lookups of keys missing from the index do not touch the
+/// file system, and the cache is kept within \p MaxSizeBytes (0 means no
+/// limit) by evicting the least recently used entries as new ones are added,
+/// instead of by scanning the directory with pruneCache().
+///
+/// The index is written back, merged with concurrent updates from other
+/// processes, after every few added entries and when the last copy of the
+/// returned cache is destroyed. The cache directory is only listed when the
+/// index file is missing or corrupt, in which case the index is rebuilt from
+/// the files found there.
+Expected<NativeObjectCache> localIndexedCache(StringRef CacheDirectoryPath,
+                                              AddBufferFn AddBuffer,
+                                              uint64_t MaxSizeBytes);
+
 } // namespace lto
 } // namespace llvm
 
@@ -19,6 +19,7 @@
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/LTO/Config.h"
@@ -105,6 +106,12 @@ public:
   /// Create an InputFile.
   static Expected<std::unique_ptr<InputFile>> create(MemoryBufferRef Object);
 
+  /// Create an InputFile for each of the given objects, reading their symbol
+  /// tables in parallel. If any object cannot be read, returns the error for
+  /// the first such object in \p Objects.
+  static Expected<std::vector<std::unique_ptr<InputFile>>>
+  create(ArrayRef<MemoryBufferRef> Objects);
+
   /// The purpose of this class is to only expose the symbol information that an
   /// LTO client should need in order to do symbol resolution.
   class Symbol : irsymtab::Symbol {
@@ -254,6 +261,13 @@ public:
   /// InputFile::symbols().
   Error add(std::unique_ptr<InputFile> Obj, ArrayRef<SymbolResolution> Res);
 
+  /// Add a batch of input files to the LTO link, where \p Res[I] holds the
+  /// symbol resolutions for \p Inputs[I]. The bitcode of the inputs is read in
+  /// parallel, but the inputs are added and their symbols resolved in the given
+  /// order, so the result is the same as calling add() for each input in turn.
+  Error add(std::vector<std::unique_ptr<InputFile>> Inputs,
+            ArrayRef<std::vector<SymbolResolution>> Res);
+
   /// Returns an upper bound on the number of tasks that the client may expect.
   /// This may only be called after all IR object files have been added. For a
   /// full description of tasks see LTOBackend.h.
@@ -373,6 +387,8 @@ private:
   // the remaining modules in the InputFile.
   Error addModule(InputFile &Input, unsigned ModI,
                   const SymbolResolution *&ResI, const SymbolResolution *ResE);
+  Error addModule(InputFile &Input, unsigned ModI, BitcodeLTOInfo LTOInfo,
+                  const SymbolResolution *&ResI, const SymbolResolution *ResE);
 
   Expected<RegularLTOState::AddedModule>
   addRegularLTO(BitcodeModule BM, ArrayRef<InputFile::Symbol> Syms,
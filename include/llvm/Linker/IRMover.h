@@ -11,12 +11,15 @@
 #define LLVM_LINKER_IRMOVER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include <functional>
+#include <vector>
 
 namespace llvm {
 class Error;
 class GlobalValue;
+class MDNode;
 class Metadata;
 class Module;
 class StructType;
@@ -78,10 +81,32 @@ public:
              bool IsPerformingImport);
   Module &getModule() { return Composite; }
 
+  /// Do the parts of moving values in from each of \p Srcs that only depend
+  /// on the source module, in parallel, so that the later calls to move() for
+  /// these modules can reuse the results. Currently this finds the named
+  /// struct types used by each module. For a fully materialized module this
+  /// would otherwise take a walk over the whole module in move(); a lazily
+  /// loaded module is not materialized, and its types are taken from its
+  /// materializer instead.
+  ///
+  /// The modules must be in the same context as the destination module, must
+  /// not be modified in between, and must each be passed to move() before they
+  /// are destroyed.
+  void prepare(ArrayRef<Module *> Srcs);
+
 private:
+  struct PreparedModule {
+    std::vector<StructType *> StructTypes;
+    /// The distinct nodes reached while finding StructTypes. If moving another
+    /// module moves one of these into the destination module, StructTypes may
+    /// be out of date.
+    std::vector<const MDNode *> DistinctMDs;
+  };
+
   Module &Composite;
   IdentifiedStructTypeSet IdentifiedStructTypes;
   MDMapT SharedMDs; ///< A Metadata map to use for all calls to \a move().
+  DenseMap<const Module *, PreparedModule> PreparedModules;
 };
 
 } // End llvm namespace
@@ -48,6 +48,10 @@ public:
                     std::function<void(Module &, const StringSet<> &)>
                         InternalizeCallback = {});
 
+  /// Prepare to link in each of \p Srcs, doing the work that only depends on
+  /// each source module in parallel. See IRMover::prepare().
+  void prepare(ArrayRef<Module *> Srcs) { Mover.prepare(Srcs); }
+
   static bool linkModules(Module &Dest, std::unique_ptr<Module> Src,
                           unsigned Flags = Flags::None,
                           std::function<void(Module &, const StringSet<> &)>
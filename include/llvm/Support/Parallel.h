@@ -70,15 +70,26 @@ public:
     std::unique_lock<std::mutex> lock(Mutex);
     Cond.wait(lock, [&] { return Count == 0; });
   }
+
+  /// Returns true if the count has dropped to zero, without blocking.
+  bool done() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Count == 0;
+  }
 };
 
 class TaskGroup {
   Latch L;
 
 public:
+  ~TaskGroup();
+
   void spawn(std::function<void()> f);
 
-  void sync() const { L.sync(); }
+  /// Waits for all spawned tasks to finish. When called from one of the
+  /// executor's worker threads (i.e. from a nested TaskGroup), the caller
+  /// runs pending tasks while it waits instead of blocking the worker.
+  void sync() const;
 };
 
 #if defined(_MSC_VER)
@@ -21,19 +21,24 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
+class ThreadPoolTaskGroup;
+
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
 /// The pool keeps a vector of threads alive, waiting on a condition variable
-/// for some work to become available.
+/// for some work to become available. Tasks can be submitted directly to the
+/// pool, or through a ThreadPoolTaskGroup, which adds a priority and allows
+/// waiting on and cancelling a subset of the tasks.
 class ThreadPool {
 public:
   using TaskTy = std::function<void()>;
@@ -70,15 +75,45 @@ public:
   void wait();
 
 private:
+  friend class ThreadPoolTaskGroup;
+
+  /// A task waiting for execution, along with its scheduling information.
+  struct QueuedTask {
+    PackagedTaskTy Task;
+    ThreadPoolTaskGroup *Group;
+    unsigned Priority;
+    /// Submission order, used to keep tasks of equal priority FIFO.
+    uint64_t Sequence;
+  };
+
+  /// Heap order for the Tasks queue: the task to run next compares greatest.
+  static bool runsAfter(const QueuedTask &LHS, const QueuedTask &RHS) {
+    if (LHS.Priority != RHS.Priority)
+      return LHS.Priority < RHS.Priority;
+    return LHS.Sequence > RHS.Sequence;
+  }
+
   /// Asynchronous submission of a task to the pool. The returned future can be
   /// used to wait for the task to finish and is *non-blocking* on destruction.
-  std::shared_future<void> asyncImpl(TaskTy F);
+  std::shared_future<void> asyncImpl(TaskTy F,
+                                     ThreadPoolTaskGroup *Group = nullptr,
+                                     unsigned Priority = 0);
+
+  /// Blocking wait for all the tasks of \p Group to complete.
+  void wait(ThreadPoolTaskGroup &Group);
+
+  /// Removes the next task to run from the queue. QueueLock must be held.
+  QueuedTask popTask();
 
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
+  /// Tasks waiting for execution in the pool, kept as a heap ordered by
+  /// runsAfter().
+  std::vector<QueuedTask> Tasks;
+
+  /// Number of tasks submitted so far.
+  uint64_t NextSequence = 0;
 
   /// Locking and signaling for accessing the Tasks queue.
   std::mutex QueueLock;
@@ -96,6 +131,58 @@ private:
   bool EnableFlag;
 #endif
 };
+
+/// A group of tasks submitted to a ThreadPool that can be waited on and
+/// cancelled independently of the other tasks in the pool.
+///
+/// Cancellation is cooperative: tasks of the group that have not started yet
+/// are skipped, and running tasks may poll isCancelled() to stop early. The
+/// futures of skipped tasks become ready as if the task had run.
+///
+/// The group waits for its tasks on destruction, so it must not outlive its
+/// pool.
+class ThreadPoolTaskGroup {
+public:
+  explicit ThreadPoolTaskGroup(ThreadPool &Pool) : Pool(Pool) {}
+
+  /// Blocking destructor: waits for all the tasks of the group to complete.
+  ~ThreadPoolTaskGroup() { wait(); }
+
+  ThreadPoolTaskGroup(const ThreadPoolTaskGroup &) = delete;
+  ThreadPoolTaskGroup &operator=(const ThreadPoolTaskGroup &) = delete;
+
+  /// Asynchronous submission of a task to the pool as part of this group.
+  /// Queued tasks with a higher \p Priority are started before tasks with a
+  /// lower one, across all groups of the pool; tasks of equal priority start
+  /// in submission order. Tasks submitted directly to the pool have priority
+  /// 0.
+  template <typename Function>
+  inline std::shared_future<void> async(Function &&F, unsigned Priority = 0) {
+    return Pool.asyncImpl(std::forward<Function>(F), this, Priority);
+  }
+
+  /// Blocking wait for all the tasks of this group to complete. Other tasks
+  /// of the pool may still be running or queued when this returns. This must
+  /// not be called from a task running on the same pool.
+  void wait() { Pool.wait(*this); }
+
+  /// Requests cancellation of the tasks of this group.
+  void cancel() { Cancelled = true; }
+
+  /// Returns true if cancel() has been called on this group.
+  bool isCancelled() const { return Cancelled; }
+
+private:
+  friend class ThreadPool;
+
+  ThreadPool &Pool;
+
+  /// Number of tasks of the group that are queued or running, guarded by the
+  /// pool's CompletionLock.
+  unsigned PendingTasks = 0;
+
+  std::atomic<bool> Cancelled{false};
+};
 }
 
 #endif // LLVM_SUPPORT_THREAD_POOL_H
@@ -46,6 +46,8 @@ class FunctionPass;
 class IntrinsicInst;
 class LoadInst;
 class LoopInfo;
+class MemorySSA;
+class MemorySSAUpdater;
 class OptimizationRemarkEmitter;
 class PHINode;
 class TargetLibraryInfo;
@@ -83,6 +85,14 @@ public:
   AliasAnalysis *getAliasAnalysis() const { return VN.getAliasAnalysis(); }
   MemoryDependenceResults &getMemDep() const { return *MD; }
 
+  /// Stop keeping MemorySSA up to date for the rest of this run.  Used when a
+  /// transform changes the IR in a way the updater cannot describe, so that
+  /// the pass does not claim to preserve a stale analysis.
+  void invalidateMemorySSA() {
+    MSSA = nullptr;
+    MSSAU = nullptr;
+  }
+
   /// This class holds the mapping between values and value numbers.  It is used
   /// as an efficient mechanism to determine the expression-wise equivalence of
   /// two values.
@@ -153,6 +163,11 @@ private:
   friend struct DenseMapInfo<Expression>;
 
   MemoryDependenceResults *MD;
+  // MemorySSA for the function if a previous pass left it cached, together
+  // with the updater used to keep it in sync.  Both are cleared as soon as GVN
+  // makes a change the updater cannot follow.
+  MemorySSA *MSSA = nullptr;
+  MemorySSAUpdater *MSSAU = nullptr;
   DominatorTree *DT;
   const TargetLibraryInfo *TLI;
   AssumptionCache *AC;
@@ -192,7 +207,7 @@ private:
   bool runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
                const TargetLibraryInfo &RunTLI, AAResults &RunAA,
                MemoryDependenceResults *RunMD, LoopInfo *LI,
-               OptimizationRemarkEmitter *ORE);
+               OptimizationRemarkEmitter *ORE, MemorySSA *RunMSSA = nullptr);
 
   /// Push a new Value to the LeaderTable onto the list for its value number.
   void addToLeaderTable(uint32_t N, Value *V, const BasicBlock *BB) {
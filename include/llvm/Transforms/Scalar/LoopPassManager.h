@@ -363,7 +363,16 @@ public:
     // We also preserve the set of standard analyses.
     PA.preserve<DominatorTreeAnalysis>();
     PA.preserve<LoopAnalysis>();
-    PA.preserve<ScalarEvolutionAnalysis>();
+    // ScalarEvolution never frees an expression before it is destroyed. Once
+    // the loop passes have left it holding a lot of memory, let it (and,
+    // through the proxy, every loop analysis) go so that the next user starts
+    // from a compact one.
+    bool ResetSCEV =
+        SCEVArenaResetThreshold &&
+        LAR.SE.getExpressionArenaSize() >=
+            (static_cast<size_t>(SCEVArenaResetThreshold) << 10);
+    if (!ResetSCEV)
+      PA.preserve<ScalarEvolutionAnalysis>();
     // FIXME: Uncomment this when all loop passes preserve MemorySSA
     // PA.preserve<MemorySSAAnalysis>();
     // FIXME: What we really want to do here is preserve an AA category, but
@@ -371,7 +380,8 @@ public:
     PA.preserve<AAManager>();
     PA.preserve<BasicAA>();
     PA.preserve<GlobalsAA>();
-    PA.preserve<SCEVAA>();
+    if (!ResetSCEV)
+      PA.preserve<SCEVAA>();
     return PA;
   }
 
@@ -136,8 +136,21 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      SmallVector<Function *, 4> SCCFunctions;
+      for (CallGraphNode *CGN : CurSCC)
+        if (Function *F = CGN->getFunction())
+          SCCFunctions.push_back(F);
+      PassTraceRegion Trace(CGSP, SCCFunctions);
       unsigned InstrCount = initSizeRemarkInfo(M);
       Changed = CGSP->runOnSCC(CurSCC);
+      if (Changed) {
+        // The pass may have replaced functions of the SCC.
+        SCCFunctions.clear();
+        for (CallGraphNode *CGN : CurSCC)
+          if (Function *F = CGN->getFunction())
+            SCCFunctions.push_back(F);
+        Trace.setSCC(SCCFunctions);
+      }
 
       // If the pass modified the module, it may have modified the instruction
       // count of the module. Try emitting a remark.
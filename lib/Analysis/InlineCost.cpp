@@ -35,14 +35,19 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <vector>
 
 using namespace llvm;
 
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCalleeWalksReused,
+          "Number of call sites analyzed by reusing a walk of the callee");
 
 static cl::opt<int> InlineThreshold(
     "inline-threshold", cl::Hidden, cl::init(225), cl::ZeroOrMore,
@@ -90,6 +95,62 @@ static cl::opt<bool> OptComputeFullInlineCost(
     cl::desc("Compute the full inline cost of a call site even when the cost "
              "exceeds the threshold."));
 
+static cl::opt<unsigned> InlineCostCacheSize(
+    "inline-cost-cache-size", cl::Hidden, cl::init(32),
+    cl::desc("Maximum number of walks of a callee kept for reuse by other "
+             "call sites (0 disables reuse)"));
+
+namespace {
+
+/// What walking a callee's body found for a given kind of call site, with the
+/// full cost computed.
+struct CalleeWalk {
+  /// Whether, and why, the walk found the callee cannot be inlined.
+  enum AbortKind {
+    NotAborted,
+    Aborted,
+    AbortedUninlinablePattern,
+    AbortedRecursiveCallerStack
+  };
+  AbortKind Abort = NotAborted;
+
+  /// What the walk added to the cost.
+  int CostDelta = 0;
+
+  bool SingleBB = true;
+  bool ContainsNoDuplicateCall = false;
+  unsigned NumInstructions = 0;
+  unsigned NumVectorInstructions = 0;
+
+  /// The constants the walk's key refers to by address. Once one of them is
+  /// destroyed another constant may get its address, so the walk can't be
+  /// reused anymore.
+  std::vector<WeakVH> KeyConstants;
+
+  bool keyConstantsAlive() const {
+    return llvm::all_of(KeyConstants,
+                        [](const WeakVH &C) { return C != nullptr; });
+  }
+};
+
+} // namespace
+
+class InlineCostCache::Impl {
+public:
+  /// Walks keyed by the call site properties they depend on (see
+  /// CallAnalyzer::getWalkKey).
+  std::map<std::vector<uint64_t>, CalleeWalk> Walks;
+};
+
+InlineCostCache::InlineCostCache() : TheImpl(new Impl) {}
+InlineCostCache::InlineCostCache(InlineCostCache &&Arg) = default;
+InlineCostCache &InlineCostCache::operator=(InlineCostCache &&RHS) = default;
+InlineCostCache::~InlineCostCache() = default;
+
+void InlineCostCache::clear() { TheImpl->Walks.clear(); }
+
+AnalysisKey InlineCostCacheAnalysis::Key;
+
 namespace {
 
 class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
@@ -125,6 +186,16 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   /// Tunable parameters that control the analysis.
   const InlineParams &Params;
 
+  /// Walks of this callee for earlier call sites, if they may be reused.
+  InlineCostCache *CalleeCache;
+
+  /// Set when the walk looked at another function's body, which makes it
+  /// depend on more than the callee.
+  bool AnalyzedOtherCallee;
+
+  /// Why analyzeBlock gave up, if it did.
+  CalleeWalk::AbortKind AbortReason;
+
   int Threshold;
   int Cost;
   bool ComputeFullInlineCost;
@@ -226,8 +297,19 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   Optional<int> getHotCallSiteThreshold(CallSite CS,
                                         BlockFrequencyInfo *CallerBFI);
 
+  /// Return the properties of the call site that walking the callee depends
+  /// on, once the arguments have been mapped, or None if they can't be
+  /// summarized. The constants the key refers to are added to \p
+  /// KeyConstants.
+  Optional<std::vector<uint64_t>>
+  getWalkKey(CallSite CS, SmallVectorImpl<Constant *> &KeyConstants);
+
+  /// Emit the remark for a walk that gave up on inlining for \p Reason.
+  void emitAbortRemark(CalleeWalk::AbortKind Reason);
+
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB, SmallPtrSetImpl<const Value *> &EphValues);
+  bool walkCallee(bool &SingleBB);
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -273,10 +355,13 @@ public:
                std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
                Optional<function_ref<BlockFrequencyInfo &(Function &)>> &GetBFI,
                ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
-               Function &Callee, CallSite CSArg, const InlineParams &Params)
+               Function &Callee, CallSite CSArg, const InlineParams &Params,
+               InlineCostCache *CalleeCache = nullptr)
       : TTI(TTI), GetAssumptionCache(GetAssumptionCache), GetBFI(GetBFI),
         PSI(PSI), F(Callee), DL(F.getParent()->getDataLayout()), ORE(ORE),
-        CandidateCS(CSArg), Params(Params), Threshold(Params.DefaultThreshold),
+        CandidateCS(CSArg), Params(Params), CalleeCache(CalleeCache),
+        AnalyzedOtherCallee(false), AbortReason(CalleeWalk::NotAborted),
+        Threshold(Params.DefaultThreshold),
         Cost(0), ComputeFullInlineCost(OptComputeFullInlineCost ||
                                        Params.ComputeFullInlineCost || ORE),
         IsCallerRecursive(false), IsRecursiveCall(false),
@@ -1291,6 +1376,7 @@ bool CallAnalyzer::visitCallSite(CallSite CS) {
   // out. Pretend to inline the function, with a custom threshold.
   auto IndirectCallParams = Params;
   IndirectCallParams.DefaultThreshold = InlineConstants::IndirectCallThreshold;
+  AnalyzedOtherCallee = true;
   CallAnalyzer CA(TTI, GetAssumptionCache, GetBFI, PSI, ORE, *F, CS,
                   IndirectCallParams);
   if (CA.analyzeCall(CS)) {
@@ -1572,17 +1658,11 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB,
     else
       Cost += InlineConstants::InstrCost;
 
-    using namespace ore;
     // If the visit this instruction detected an uninlinable pattern, abort.
     if (IsRecursiveCall || ExposesReturnsTwice || HasDynamicAlloca ||
         HasIndirectBr || HasUninlineableIntrinsic || UsesVarArgs) {
-      if (ORE)
-        ORE->emit([&]() {
-          return OptimizationRemarkMissed(DEBUG_TYPE, "NeverInline",
-                                          CandidateCS.getInstruction())
-                 << NV("Callee", &F)
-                 << " has uninlinable pattern and cost is not fully computed";
-        });
+      AbortReason = CalleeWalk::AbortedUninlinablePattern;
+      emitAbortRemark(AbortReason);
       return false;
     }
 
@@ -1591,14 +1671,8 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB,
     // the caller stack usage dramatically.
     if (IsCallerRecursive &&
         AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller) {
-      if (ORE)
-        ORE->emit([&]() {
-          return OptimizationRemarkMissed(DEBUG_TYPE, "NeverInline",
-                                          CandidateCS.getInstruction())
-                 << NV("Callee", &F)
-                 << " is recursive and allocates too much stack space. Cost is "
-                    "not fully computed";
-        });
+      AbortReason = CalleeWalk::AbortedRecursiveCallerStack;
+      emitAbortRemark(AbortReason);
       return false;
     }
 
@@ -1611,6 +1685,80 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB,
   return true;
 }
 
+void CallAnalyzer::emitAbortRemark(CalleeWalk::AbortKind Reason) {
+  if (!ORE)
+    return;
+  using namespace ore;
+  if (Reason == CalleeWalk::AbortedUninlinablePattern)
+    ORE->emit([&]() {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "NeverInline",
+                                      CandidateCS.getInstruction())
+             << NV("Callee", &F)
+             << " has uninlinable pattern and cost is not fully computed";
+    });
+  else if (Reason == CalleeWalk::AbortedRecursiveCallerStack)
+    ORE->emit([&]() {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "NeverInline",
+                                      CandidateCS.getInstruction())
+             << NV("Callee", &F)
+             << " is recursive and allocates too much stack space. Cost is "
+                "not fully computed";
+    });
+}
+
+Optional<std::vector<uint64_t>>
+CallAnalyzer::getWalkKey(CallSite CS,
+                         SmallVectorImpl<Constant *> &KeyConstants) {
+  // The walk sees the caller's arguments only through the maps populated from
+  // them, and the caller only through IsCallerRecursive and the call site's
+  // nonnull attributes. Which value a non-constant base is doesn't matter,
+  // only which arguments share it.
+  enum : uint64_t {
+    PlainArg,
+    ConstantArg,
+    OffsetPtrArg,
+    AllocaBase = 1 << 2,
+    ConstantBase = 1 << 3,
+    NonNullArg = 1 << 4
+  };
+  std::vector<uint64_t> Key;
+  SmallDenseMap<Value *, unsigned, 4> BaseArgs;
+  for (Argument &A : F.args()) {
+    uint64_t Tag = paramHasAttr(&A, Attribute::NonNull) ? NonNullArg : 0;
+    if (Constant *C = SimplifiedValues.lookup(&A)) {
+      Key.push_back(Tag | ConstantArg);
+      Key.push_back(reinterpret_cast<uintptr_t>(C));
+      KeyConstants.push_back(C);
+      continue;
+    }
+    auto PI = ConstantOffsetPtrs.find(&A);
+    if (PI == ConstantOffsetPtrs.end()) {
+      Key.push_back(Tag | PlainArg);
+      continue;
+    }
+    Value *Base = PI->second.first;
+    const APInt &Offset = PI->second.second;
+    if (Offset.getBitWidth() > 64)
+      return None;
+    Tag |= OffsetPtrArg;
+    uint64_t BaseKey;
+    if (auto *C = dyn_cast<Constant>(Base)) {
+      Tag |= ConstantBase;
+      BaseKey = reinterpret_cast<uintptr_t>(C);
+      KeyConstants.push_back(C);
+    } else {
+      if (isa<AllocaInst>(Base))
+        Tag |= AllocaBase;
+      BaseKey = BaseArgs.insert({Base, A.getArgNo()}).first->second;
+    }
+    Key.push_back(Tag);
+    Key.push_back(BaseKey);
+    Key.push_back(Offset.getZExtValue());
+  }
+  Key.push_back(IsCallerRecursive);
+  return Key;
+}
+
 /// Compute the base pointer and cumulative constant offsets for V.
 ///
 /// This strips all constant offsets off of V, leaving it the base pointer, and
@@ -1688,6 +1836,103 @@ void CallAnalyzer::findDeadBlocks(BasicBlock *CurrBB, BasicBlock *NextBB) {
   }
 }
 
+/// Walk the blocks of the callee that are live for this call site, adding
+/// their cost. Returns false if the callee turns out not to be inlinable.
+///
+/// \p SingleBB is cleared, and the single block bonus taken off the
+/// threshold, once more than one block is found to be live.
+bool CallAnalyzer::walkCallee(bool &SingleBB) {
+  // FIXME: If a caller has multiple calls to a callee that can't share a walk,
+  // we end up recomputing the ephemeral values multiple times (and they're
+  // completely determined by the callee, so this is purely duplicate work).
+  SmallPtrSet<const Value *, 32> EphValues;
+  CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F), EphValues);
+
+  // The worklist of live basic blocks in the callee *after* inlining. We avoid
+  // adding basic blocks of the callee which can be proven to be dead for this
+  // particular call site in order to get more accurate cost estimates. This
+  // requires a somewhat heavyweight iteration pattern: we need to walk the
+  // basic blocks in a breadth-first order as we insert live successors. To
+  // accomplish this, prioritizing for small iterations because we exit after
+  // crossing our threshold, we use a small-size optimized SetVector.
+  typedef SetVector<BasicBlock *, SmallVector<BasicBlock *, 16>,
+                    SmallPtrSet<BasicBlock *, 16>>
+      BBSetVector;
+  BBSetVector BBWorklist;
+  BBWorklist.insert(&F.getEntryBlock());
+  // Note that we *must not* cache the size, this loop grows the worklist.
+  for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
+    // Bail out the moment we cross the threshold. This means we'll under-count
+    // the cost, but only when undercounting doesn't matter.
+    if (Cost >= Threshold && !ComputeFullInlineCost)
+      break;
+
+    BasicBlock *BB = BBWorklist[Idx];
+    if (BB->empty())
+      continue;
+
+    // Disallow inlining a blockaddress. A blockaddress only has defined
+    // behavior for an indirect branch in the same function, and we do not
+    // currently support inlining indirect branches. But, the inliner may not
+    // see an indirect branch that ends up being dead code at a particular call
+    // site. If the blockaddress escapes the function, e.g., via a global
+    // variable, inlining may lead to an invalid cross-function reference.
+    if (BB->hasAddressTaken())
+      return false;
+
+    // Analyze the cost of this block. If we blow through the threshold, this
+    // returns false, and we can bail on out.
+    if (!analyzeBlock(BB, EphValues))
+      return false;
+
+    TerminatorInst *TI = BB->getTerminator();
+
+    // Add in the live successors by first checking whether we have terminator
+    // that may be simplified based on the values simplified by this call.
+    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+      if (BI->isConditional()) {
+        Value *Cond = BI->getCondition();
+        if (ConstantInt *SimpleCond =
+                dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
+          BasicBlock *NextBB = BI->getSuccessor(SimpleCond->isZero() ? 1 : 0);
+          BBWorklist.insert(NextBB);
+          KnownSuccessors[BB] = NextBB;
+          findDeadBlocks(BB, NextBB);
+          continue;
+        }
+      }
+    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+      Value *Cond = SI->getCondition();
+      if (ConstantInt *SimpleCond =
+              dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
+        BasicBlock *NextBB = SI->findCaseValue(SimpleCond)->getCaseSuccessor();
+        BBWorklist.insert(NextBB);
+        KnownSuccessors[BB] = NextBB;
+        findDeadBlocks(BB, NextBB);
+        continue;
+      }
+    }
+
+    // If we're unable to select a particular successor, just count all of
+    // them.
+    for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
+         ++TIdx)
+      BBWorklist.insert(TI->getSuccessor(TIdx));
+
+    // If we had any successors at this point, than post-inlining is likely to
+    // have them as well. Note that we assume any basic blocks which existed
+    // due to branches or switches which folded above will also fold after
+    // inlining.
+    if (SingleBB && TI->getNumSuccessors() > 1) {
+      // Take off the bonus we applied to the threshold.
+      Threshold -= SingleBBBonus;
+      SingleBB = false;
+    }
+  }
+
+  return true;
+}
+
 /// Analyze a call site for potential inlining.
 ///
 /// Returns true if inlining this call is viable, and false if it is not
@@ -1772,93 +2017,64 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
 
-  // FIXME: If a caller has multiple calls to a callee, we end up recomputing
-  // the ephemeral values multiple times (and they're completely determined by
-  // the callee, so this is purely duplicate work).
-  SmallPtrSet<const Value *, 32> EphValues;
-  CodeMetrics::collectEphemeralValues(&F, &GetAssumptionCache(F), EphValues);
-
-  // The worklist of live basic blocks in the callee *after* inlining. We avoid
-  // adding basic blocks of the callee which can be proven to be dead for this
-  // particular call site in order to get more accurate cost estimates. This
-  // requires a somewhat heavyweight iteration pattern: we need to walk the
-  // basic blocks in a breadth-first order as we insert live successors. To
-  // accomplish this, prioritizing for small iterations because we exit after
-  // crossing our threshold, we use a small-size optimized SetVector.
-  typedef SetVector<BasicBlock *, SmallVector<BasicBlock *, 16>,
-                    SmallPtrSet<BasicBlock *, 16>>
-      BBSetVector;
-  BBSetVector BBWorklist;
-  BBWorklist.insert(&F.getEntryBlock());
-  bool SingleBB = true;
-  // Note that we *must not* cache the size, this loop grows the worklist.
-  for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
-    // Bail out the moment we cross the threshold. This means we'll under-count
-    // the cost, but only when undercounting doesn't matter.
-    if (Cost >= Threshold && !ComputeFullInlineCost)
-      break;
-
-    BasicBlock *BB = BBWorklist[Idx];
-    if (BB->empty())
-      continue;
-
-    // Disallow inlining a blockaddress. A blockaddress only has defined
-    // behavior for an indirect branch in the same function, and we do not
-    // currently support inlining indirect branches. But, the inliner may not
-    // see an indirect branch that ends up being dead code at a particular call
-    // site. If the blockaddress escapes the function, e.g., via a global
-    // variable, inlining may lead to an invalid cross-function reference.
-    if (BB->hasAddressTaken())
-      return false;
-
-    // Analyze the cost of this block. If we blow through the threshold, this
-    // returns false, and we can bail on out.
-    if (!analyzeBlock(BB, EphValues))
-      return false;
-
-    TerminatorInst *TI = BB->getTerminator();
-
-    // Add in the live successors by first checking whether we have terminator
-    // that may be simplified based on the values simplified by this call.
-    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
-      if (BI->isConditional()) {
-        Value *Cond = BI->getCondition();
-        if (ConstantInt *SimpleCond =
-                dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
-          BasicBlock *NextBB = BI->getSuccessor(SimpleCond->isZero() ? 1 : 0);
-          BBWorklist.insert(NextBB);
-          KnownSuccessors[BB] = NextBB;
-          findDeadBlocks(BB, NextBB);
-          continue;
-        }
-      }
-    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
-      Value *Cond = SI->getCondition();
-      if (ConstantInt *SimpleCond =
-              dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
-        BasicBlock *NextBB = SI->findCaseValue(SimpleCond)->getCaseSuccessor();
-        BBWorklist.insert(NextBB);
-        KnownSuccessors[BB] = NextBB;
-        findDeadBlocks(BB, NextBB);
-        continue;
-      }
+  // Once the full cost is computed, the walk below doesn't depend on the
+  // threshold, so call sites that agree on the properties it does depend on
+  // can share it.
+  Optional<std::vector<uint64_t>> WalkKey;
+  SmallVector<Constant *, 4> KeyConstants;
+  if (CalleeCache && ComputeFullInlineCost && InlineCostCacheSize)
+    WalkKey = getWalkKey(CS, KeyConstants);
+
+  auto *Walks = WalkKey ? &CalleeCache->getImpl().Walks : nullptr;
+  const CalleeWalk *CachedWalk = nullptr;
+  if (Walks) {
+    auto WI = Walks->find(*WalkKey);
+    if (WI != Walks->end()) {
+      if (WI->second.keyConstantsAlive())
+        CachedWalk = &WI->second;
+      else
+        Walks->erase(WI);
     }
+  }
 
-    // If we're unable to select a particular successor, just count all of
-    // them.
-    for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
-         ++TIdx)
-      BBWorklist.insert(TI->getSuccessor(TIdx));
-
-    // If we had any successors at this point, than post-inlining is likely to
-    // have them as well. Note that we assume any basic blocks which existed
-    // due to branches or switches which folded above will also fold after
-    // inlining.
-    if (SingleBB && TI->getNumSuccessors() > 1) {
-      // Take off the bonus we applied to the threshold.
+  if (CachedWalk) {
+    const CalleeWalk &Walk = *CachedWalk;
+    ++NumCalleeWalksReused;
+    LLVM_DEBUG(dbgs() << "      Reusing a walk of " << F.getName() << "\n");
+    Cost += Walk.CostDelta;
+    if (!Walk.SingleBB)
       Threshold -= SingleBBBonus;
-      SingleBB = false;
+    if (Walk.Abort != CalleeWalk::NotAborted) {
+      emitAbortRemark(Walk.Abort);
+      return false;
+    }
+    NumInstructions = Walk.NumInstructions;
+    NumVectorInstructions = Walk.NumVectorInstructions;
+    ContainsNoDuplicateCall = Walk.ContainsNoDuplicateCall;
+  } else {
+    int CostBeforeWalk = Cost;
+    bool SingleBB = true;
+    bool Completed = walkCallee(SingleBB);
+
+    // A walk that looked into another function's body depends on more than
+    // the callee, and one whose cost got near overflowing may have been
+    // clamped.
+    if (Walks && !AnalyzedOtherCallee && Walks->size() < InlineCostCacheSize &&
+        Cost < INT_MAX / 2) {
+      CalleeWalk &Walk = (*Walks)[*WalkKey];
+      Walk.CostDelta = Cost - CostBeforeWalk;
+      Walk.SingleBB = SingleBB;
+      if (!Completed)
+        Walk.Abort = AbortReason != CalleeWalk::NotAborted
+                         ? AbortReason
+                         : CalleeWalk::Aborted;
+      Walk.ContainsNoDuplicateCall = ContainsNoDuplicateCall;
+      Walk.NumInstructions = NumInstructions;
+      Walk.NumVectorInstructions = NumVectorInstructions;
+      Walk.KeyConstants.assign(KeyConstants.begin(), KeyConstants.end());
     }
+    if (!Completed)
+      return false;
   }
 
   bool OnlyOneCallAndLocalLinkage =
@@ -1947,9 +2163,10 @@ InlineCost llvm::getInlineCost(
     CallSite CS, const InlineParams &Params, TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE) {
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+    InlineCostCache *CalleeCache) {
   return getInlineCost(CS, CS.getCalledFunction(), Params, CalleeTTI,
-                       GetAssumptionCache, GetBFI, PSI, ORE);
+                       GetAssumptionCache, GetBFI, PSI, ORE, CalleeCache);
 }
 
 InlineCost llvm::getInlineCost(
@@ -1957,7 +2174,8 @@ InlineCost llvm::getInlineCost(
     TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE) {
+    ProfileSummaryInfo *PSI, OptimizationRemarkEmitter *ORE,
+    InlineCostCache *CalleeCache) {
 
   // Cannot inline indirect calls.
   if (!Callee)
@@ -2011,7 +2229,7 @@ InlineCost llvm::getInlineCost(
                           << "... (caller:" << Caller->getName() << ")\n");
 
   CallAnalyzer CA(CalleeTTI, GetAssumptionCache, GetBFI, PSI, ORE, *Callee, CS,
-                  Params);
+                  Params, CalleeCache);
   bool ShouldInline = CA.analyzeCall(CS);
 
   LLVM_DEBUG(CA.dump());
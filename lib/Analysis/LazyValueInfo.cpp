@@ -15,6 +15,7 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
@@ -33,6 +34,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/raw_ostream.h"
@@ -42,10 +44,20 @@ using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumCacheEntriesEvicted,
+          "Number of cached block values evicted to stay under the limit");
+STATISTIC(MaxCacheEntries, "Largest number of block values cached at once");
+
 // This is the number of worklist items we will process to try to discover an
 // answer for a given value.
 static const unsigned MaxProcessedPerValue = 500;
 
+static cl::opt<unsigned> MaxCachedBlockValues(
+    "lvi-max-cached-block-values", cl::Hidden, cl::init(1000000),
+    cl::desc("Maximum number of block values (overdefined or not) that "
+             "LazyValueInfo caches for a function before evicting the least "
+             "recently used values (0 = no limit)"));
+
 char LazyValueInfoWrapperPass::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfoWrapperPass, "lazy-value-info",
                 "Lazy Value Information Analysis", false, true)
@@ -175,6 +187,47 @@ namespace {
     DenseMap<Value *, std::unique_ptr<ValueCacheEntryTy>> ValueCache;
     OverDefinedCacheTy OverDefinedCache;
 
+    /// What the eviction policy needs to know about the cached entries of
+    /// one value.
+    struct ValueUsageTy {
+      /// The last query that asked for or computed the value.
+      unsigned LastQuery;
+      /// Breaks ties between values last used by the same query, in the
+      /// (deterministic) order they were first cached.
+      unsigned Seq;
+      /// The number of blocks the value has an entry for, in either cache.
+      unsigned NumEntries;
+    };
+    DenseMap<Value *, ValueUsageTy> Usage;
+
+    /// The number of entries in ValueCache and OverDefinedCache together.
+    unsigned NumEntries = 0;
+    unsigned CurrentQuery = 0;
+    unsigned NextSeq = 0;
+
+    void addedEntry(Value *V) {
+      auto Inserted = Usage.insert({V, {CurrentQuery, NextSeq, 0}});
+      if (Inserted.second)
+        ++NextSeq;
+      ValueUsageTy &U = Inserted.first->second;
+      U.LastQuery = CurrentQuery;
+      ++U.NumEntries;
+      MaxCacheEntries.updateMax(++NumEntries);
+    }
+
+    void removedEntries(Value *V, unsigned N) {
+      auto It = Usage.find(V);
+      assert(It != Usage.end() && It->second.NumEntries >= N &&
+             "Removing entries that weren't counted!");
+      NumEntries -= N;
+      It->second.NumEntries -= N;
+      if (!It->second.NumEntries)
+        Usage.erase(It);
+    }
+
+    /// Drop the least recently used values until the cache is at half its
+    /// limit.
+    void evict();
 
   public:
     void insertResult(Value *Val, BasicBlock *BB,
@@ -183,19 +236,37 @@ namespace {
 
       // Insert over-defined values into their own cache to reduce memory
       // overhead.
-      if (Result.isOverdefined())
-        OverDefinedCache[BB].insert(Val);
-      else {
+      if (Result.isOverdefined()) {
+        if (OverDefinedCache[BB].insert(Val).second)
+          addedEntry(Val);
+      } else {
         auto It = ValueCache.find_as(Val);
         if (It == ValueCache.end()) {
           ValueCache[Val] = make_unique<ValueCacheEntryTy>(Val, this);
           It = ValueCache.find_as(Val);
           assert(It != ValueCache.end() && "Val was just added to the map!");
         }
-        It->second->BlockVals[BB] = Result;
+        auto Inserted = It->second->BlockVals.insert({BB, Result});
+        if (Inserted.second)
+          addedEntry(Val);
+        else
+          Inserted.first->second = Result;
       }
     }
 
+    /// Start a new top-level query for \p V. This is the only point at which
+    /// entries are evicted, since the solver relies on the entries it has
+    /// computed staying around until the query is answered. Evicted entries
+    /// are simply recomputed by a later query that needs them.
+    void beginQuery(Value *V) {
+      ++CurrentQuery;
+      auto It = Usage.find(V);
+      if (It != Usage.end())
+        It->second.LastQuery = CurrentQuery;
+      if (MaxCachedBlockValues && NumEntries > MaxCachedBlockValues)
+        evict();
+    }
+
     bool isOverdefined(Value *V, BasicBlock *BB) const {
       auto ODI = OverDefinedCache.find(BB);
 
@@ -234,6 +305,8 @@ namespace {
       SeenBlocks.clear();
       ValueCache.clear();
       OverDefinedCache.clear();
+      Usage.clear();
+      NumEntries = 0;
     }
 
     /// Inform the cache that a given value has been deleted.
@@ -264,6 +337,49 @@ void LazyValueInfoCache::eraseValue(Value *V) {
   }
 
   ValueCache.erase(V);
+
+  auto UI = Usage.find(V);
+  if (UI != Usage.end()) {
+    NumEntries -= UI->second.NumEntries;
+    Usage.erase(UI);
+  }
+}
+
+void LazyValueInfoCache::evict() {
+  SmallVector<std::pair<std::pair<unsigned, unsigned>, Value *>, 0> ByAge;
+  ByAge.reserve(Usage.size());
+  for (auto &U : Usage)
+    ByAge.push_back({{U.second.LastQuery, U.second.Seq}, U.first});
+  llvm::sort(ByAge.begin(), ByAge.end());
+
+  DenseSet<Value *> Evicted;
+  unsigned Target = MaxCachedBlockValues / 2;
+  for (auto &Entry : ByAge) {
+    if (NumEntries <= Target)
+      break;
+    Value *V = Entry.second;
+    auto UI = Usage.find(V);
+    NumEntries -= UI->second.NumEntries;
+    NumCacheEntriesEvicted += UI->second.NumEntries;
+    Usage.erase(UI);
+    ValueCache.erase(V);
+    Evicted.insert(V);
+  }
+  LLVM_DEBUG(dbgs() << "LVI evicted " << Evicted.size() << " values, "
+                    << NumEntries << " block values remain cached\n");
+
+  for (auto I = OverDefinedCache.begin(), E = OverDefinedCache.end(); I != E;) {
+    auto Iter = I++;
+    SmallPtrSetImpl<Value *> &ValueSet = Iter->second;
+    SmallVector<Value *, 4> ToErase;
+    for (Value *V : ValueSet)
+      if (Evicted.count(V))
+        ToErase.push_back(V);
+    for (Value *V : ToErase)
+      ValueSet.erase(V);
+    if (ValueSet.empty())
+      OverDefinedCache.erase(Iter);
+  }
 }
 
 void LVIValueHandle::deleted() {
@@ -280,11 +396,15 @@ void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   SeenBlocks.erase(I);
 
   auto ODI = OverDefinedCache.find(BB);
-  if (ODI != OverDefinedCache.end())
+  if (ODI != OverDefinedCache.end()) {
+    for (Value *V : ODI->second)
+      removedEntries(V, 1);
     OverDefinedCache.erase(ODI);
+  }
 
   for (auto &I : ValueCache)
-    I.second->BlockVals.erase(BB);
+    if (I.second->BlockVals.erase(BB))
+      removedEntries(I.first, 1);
 }
 
 void LazyValueInfoCache::threadEdgeImpl(BasicBlock *OldSucc,
@@ -328,6 +448,7 @@ void LazyValueInfoCache::threadEdgeImpl(BasicBlock *OldSucc,
     for (Value *V : ValsToClear) {
       if (!ValueSet.erase(V))
         continue;
+      removedEntries(V, 1);
 
       // If we removed anything, then we potentially need to update
       // blocks successors too.
@@ -1407,6 +1528,7 @@ ValueLatticeElement LazyValueInfoImpl::getValueInBlock(Value *V, BasicBlock *BB,
                     << BB->getName() << "'\n");
 
   assert(BlockValueStack.empty() && BlockValueSet.empty());
+  TheCache.beginQuery(V);
   if (!hasBlockValue(V, BB)) {
     pushBlockValue(std::make_pair(BB, V));
     solve();
@@ -1441,6 +1563,7 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB,
                     << FromBB->getName() << "' to '" << ToBB->getName()
                     << "'\n");
 
+  TheCache.beginQuery(V);
   ValueLatticeElement Result;
   if (!getEdgeValue(V, FromBB, ToBB, Result, CxtI)) {
     solve();
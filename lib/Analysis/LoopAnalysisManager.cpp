@@ -24,6 +24,11 @@ cl::opt<bool> EnableMSSALoopDependency(
     "enable-mssa-loop-dependency", cl::Hidden, cl::init(false),
     cl::desc("Enable MemorySSA dependency for loop pass manager"));
 
+cl::opt<unsigned> SCEVArenaResetThreshold(
+    "scev-arena-reset-threshold", cl::Hidden, cl::init(1024 * 1024),
+    cl::desc("Drop ScalarEvolution after a loop pipeline once its expression "
+             "arena exceeds this many kilobytes (0 = never)"));
+
 // Explicit template instantiations and specialization definitions for core
 // template typedefs.
 template class AllAnalysesOn<Loop>;
@@ -210,6 +210,15 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        auto GetLoopSize = [&]() -> unsigned {
+          if (CurrentLoopDeleted)
+            return 0;
+          unsigned Size = 0;
+          for (BasicBlock *BB : CurrentLoop->blocks())
+            Size += BB->size();
+          return Size;
+        };
+        PassTraceRegion Trace(P, CurrentLoop->getName(), GetLoopSize);
         unsigned InstrCount = initSizeRemarkInfo(M);
         Changed |= P->runOnLoop(CurrentLoop, *this);
         emitInstrCountChangedRemark(P, M, InstrCount);
@@ -94,6 +94,15 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        auto GetRegionSize = [&]() -> unsigned {
+          if (skipThisRegion)
+            return 0;
+          unsigned Size = 0;
+          for (BasicBlock *BB : CurrentRegion->blocks())
+            Size += BB->size();
+          return Size;
+        };
+        PassTraceRegion Trace(P, CurrentRegion->getNameStr(), GetRegionSize);
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
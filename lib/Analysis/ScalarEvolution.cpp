@@ -6541,7 +6541,10 @@ ScalarEvolution::getPredicatedBackedgeTakenInfo(const Loop *L) {
   BackedgeTakenInfo Result =
       computeBackedgeTakenCount(L, /*AllowPredicates=*/true);
 
-  return PredicatedBackedgeTakenCounts.find(L)->second = std::move(Result);
+  BackedgeTakenInfo &PredBTI =
+      PredicatedBackedgeTakenCounts.find(L)->second = std::move(Result);
+  addBECountUsers(L, PredBTI, /*Predicated=*/true);
+  return PredBTI;
 }
 
 const ScalarEvolution::BackedgeTakenInfo &
@@ -6644,20 +6647,43 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // recusive call to getBackedgeTakenInfo (on a different
   // loop), which would invalidate the iterator computed
   // earlier.
-  return BackedgeTakenCounts.find(L)->second = std::move(Result);
+  BackedgeTakenInfo &BTI = BackedgeTakenCounts.find(L)->second =
+      std::move(Result);
+  addBECountUsers(L, BTI, /*Predicated=*/false);
+  return BTI;
 }
 
-void ScalarEvolution::forgetLoop(const Loop *L) {
-  // Drop any stored trip count value.
-  auto RemoveLoopFromBackedgeMap =
-      [](DenseMap<const Loop *, BackedgeTakenInfo> &Map, const Loop *L) {
-        auto BTCPos = Map.find(L);
-        if (BTCPos != Map.end()) {
-          BTCPos->second.clear();
-          Map.erase(BTCPos);
-        }
-      };
+void ScalarEvolution::addBECountUsers(const Loop *L,
+                                      const BackedgeTakenInfo &BTI,
+                                      bool Predicated) {
+  SmallPtrSet<const SCEV *, 16> Ops;
+  BTI.getOperands(Ops);
+  for (const SCEV *S : Ops)
+    BECountUsers[S].insert({L, Predicated});
+}
+
+void ScalarEvolution::eraseBackedgeTakenInfo(const Loop *L, bool Predicated) {
+  auto &Map = Predicated ? PredicatedBackedgeTakenCounts : BackedgeTakenCounts;
+  auto BTCPos = Map.find(L);
+  if (BTCPos == Map.end())
+    return;
+
+  SmallPtrSet<const SCEV *, 16> Ops;
+  BTCPos->second.getOperands(Ops);
+  for (const SCEV *S : Ops) {
+    auto UsersIt = BECountUsers.find(S);
+    if (UsersIt == BECountUsers.end())
+      continue;
+    UsersIt->second.erase({L, Predicated});
+    if (UsersIt->second.empty())
+      BECountUsers.erase(UsersIt);
+  }
 
+  BTCPos->second.clear();
+  Map.erase(BTCPos);
+}
+
+void ScalarEvolution::forgetLoop(const Loop *L) {
   SmallVector<const Loop *, 16> LoopWorklist(1, L);
   SmallVector<Instruction *, 32> Worklist;
   SmallPtrSet<Instruction *, 16> Visited;
@@ -6666,8 +6692,9 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
   while (!LoopWorklist.empty()) {
     auto *CurrL = LoopWorklist.pop_back_val();
 
-    RemoveLoopFromBackedgeMap(BackedgeTakenCounts, CurrL);
-    RemoveLoopFromBackedgeMap(PredicatedBackedgeTakenCounts, CurrL);
+    // Drop any stored trip count value.
+    eraseBackedgeTakenInfo(CurrL, /*Predicated=*/false);
+    eraseBackedgeTakenInfo(CurrL, /*Predicated=*/true);
 
     // Drop information about predicated SCEV rewrites for this loop.
     for (auto I = PredicatedSCEVRewrites.begin();
@@ -6819,18 +6846,24 @@ bool ScalarEvolution::BackedgeTakenInfo::isMaxOrZero(ScalarEvolution *SE) const
   return MaxOrZero && !any_of(ExitNotTaken, PredicateNotAlwaysTrue);
 }
 
-bool ScalarEvolution::BackedgeTakenInfo::hasOperand(const SCEV *S,
-                                                    ScalarEvolution *SE) const {
-  if (getMax() && getMax() != SE->getCouldNotCompute() &&
-      SE->hasOperand(getMax(), S))
-    return true;
+void ScalarEvolution::BackedgeTakenInfo::getOperands(
+    SmallPtrSetImpl<const SCEV *> &Ops) const {
+  struct CollectOperands {
+    SmallPtrSetImpl<const SCEV *> &Ops;
 
-  for (auto &ENT : ExitNotTaken)
-    if (ENT.ExactNotTaken != SE->getCouldNotCompute() &&
-        SE->hasOperand(ENT.ExactNotTaken, S))
-      return true;
+    // Anything already collected had its operands collected with it.
+    bool follow(const SCEV *S) { return Ops.insert(S).second; }
+    bool isDone() const { return false; }
+  };
 
-  return false;
+  CollectOperands Collector{Ops};
+  auto Collect = [&](const SCEV *S) {
+    if (S && !isa<SCEVCouldNotCompute>(S))
+      visitAll(S, Collector);
+  };
+  Collect(getMax());
+  for (auto &ENT : ExitNotTaken)
+    Collect(ENT.ExactNotTaken);
 }
 
 ScalarEvolution::ExitLimit::ExitLimit(const SCEV *E)
@@ -11091,6 +11124,7 @@ ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
       BackedgeTakenCounts(std::move(Arg.BackedgeTakenCounts)),
       PredicatedBackedgeTakenCounts(
           std::move(Arg.PredicatedBackedgeTakenCounts)),
+      BECountUsers(std::move(Arg.BECountUsers)),
       ConstantEvolutionLoopExitValue(
           std::move(Arg.ConstantEvolutionLoopExitValue)),
       ValuesAtScopes(std::move(Arg.ValuesAtScopes)),
@@ -11128,6 +11162,7 @@ ScalarEvolution::~ScalarEvolution() {
     BTCI.second.clear();
   for (auto &BTCI : PredicatedBackedgeTakenCounts)
     BTCI.second.clear();
+  BECountUsers.clear();
 
   assert(PendingLoopPredicates.empty() && "isImpliedCond garbage");
   assert(PendingPhiRanges.empty() && "getRangeRef garbage");
@@ -11517,29 +11552,27 @@ ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
   HasRecMap.erase(S);
   MinTrailingZerosCache.erase(S);
 
-  for (auto I = PredicatedSCEVRewrites.begin();
-       I != PredicatedSCEVRewrites.end();) {
-    std::pair<const SCEV *, const Loop *> Entry = I->first;
-    if (Entry.first == S)
-      PredicatedSCEVRewrites.erase(I++);
-    else
-      ++I;
-  }
-
-  auto RemoveSCEVFromBackedgeMap =
-      [S, this](DenseMap<const Loop *, BackedgeTakenInfo> &Map) {
-        for (auto I = Map.begin(), E = Map.end(); I != E;) {
-          BackedgeTakenInfo &BEInfo = I->second;
-          if (BEInfo.hasOperand(S, this)) {
-            BEInfo.clear();
-            Map.erase(I++);
-          } else
-            ++I;
-        }
-      };
+  // Only SCEVUnknowns are rewritten.
+  if (isa<SCEVUnknown>(S))
+    for (auto I = PredicatedSCEVRewrites.begin();
+         I != PredicatedSCEVRewrites.end();) {
+      std::pair<const SCEV *, const Loop *> Entry = I->first;
+      if (Entry.first == S)
+        PredicatedSCEVRewrites.erase(I++);
+      else
+        ++I;
+    }
 
-  RemoveSCEVFromBackedgeMap(BackedgeTakenCounts);
-  RemoveSCEVFromBackedgeMap(PredicatedBackedgeTakenCounts);
+  // Drop the backedge-taken counts that use S. Erasing them updates
+  // BECountUsers, so work from a copy of the user list.
+  auto UsersIt = BECountUsers.find(S);
+  if (UsersIt == BECountUsers.end())
+    return;
+  auto Users = std::move(UsersIt->second);
+  BECountUsers.erase(UsersIt);
+  for (auto LoopAndPredicated : Users)
+    eraseBackedgeTakenInfo(LoopAndPredicated.getPointer(),
+                           LoopAndPredicated.getInt());
 }
 
 void
@@ -90,6 +90,8 @@ using namespace llvm;
 STATISTIC(NumMDStringLoaded, "Number of MDStrings loaded");
 STATISTIC(NumMDNodeTemporary, "Number of MDNode::Temporary created");
 STATISTIC(NumMDRecordLoaded, "Number of Metadata records loaded");
+STATISTIC(NumCUListsSkipped,
+          "Number of compile unit lists skipped when importing");
 
 /// Flag whether we need to import full type definitions for ThinLTO.
 /// Currently needed for Darwin and LLDB.
@@ -97,6 +99,13 @@ static cl::opt<bool> ImportFullTypeDefinitions(
     "import-full-type-definitions", cl::init(false), cl::Hidden,
     cl::desc("Import full type definitions for ThinLTO."));
 
+/// Currently needed for testing.
+static cl::opt<bool> ImportCompileUnitLists(
+    "import-compile-unit-lists", cl::init(false), cl::Hidden,
+    cl::desc("Load the enums, retained types, global variables and macros "
+             "listed on compile units when loading bitcode for ThinLTO "
+             "importing."));
+
 static cl::opt<bool> DisableLazyLoading(
     "disable-ondemand-mds-loading", cl::init(false), cl::Hidden,
     cl::desc("Force disable the lazy-loading on-demand of metadata when "
@@ -1381,12 +1390,34 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
     // Ignore Record[0], which indicates whether this compile unit is
     // distinct.  It's always distinct.
     IsDistinct = true;
+
+    // If this module is being parsed so that it can be ThinLTO imported into
+    // another module, the enums, retained types, global variables and macros
+    // listed on the compile unit are not needed: the IRMover drops them from
+    // the imported compile unit, and anything an imported function uses is
+    // reached from the function instead. Leave them out so that on-demand
+    // loading does not pull in all of the metadata they reach.
+    Metadata *EnumTypes = nullptr;
+    Metadata *RetainedTypes = nullptr;
+    Metadata *GlobalVariables = nullptr;
+    Metadata *Macros = nullptr;
+    if (IsImporting && !ImportCompileUnitLists) {
+      for (unsigned I : {9, 10, 12, 15})
+        if (I < Record.size() && Record[I])
+          ++NumCUListsSkipped;
+    } else {
+      EnumTypes = getMDOrNull(Record[9]);
+      RetainedTypes = getMDOrNull(Record[10]);
+      GlobalVariables = getMDOrNull(Record[12]);
+      if (Record.size() > 15)
+        Macros = getMDOrNull(Record[15]);
+    }
+
     auto *CU = DICompileUnit::getDistinct(
         Context, Record[1], getMDOrNull(Record[2]), getMDString(Record[3]),
         Record[4], getMDString(Record[5]), Record[6], getMDString(Record[7]),
-        Record[8], getMDOrNull(Record[9]), getMDOrNull(Record[10]),
-        getMDOrNull(Record[12]), getMDOrNull(Record[13]),
-        Record.size() <= 15 ? nullptr : getMDOrNull(Record[15]),
+        Record[8], EnumTypes, RetainedTypes, GlobalVariables,
+        getMDOrNull(Record[13]), Macros,
         Record.size() <= 14 ? 0 : Record[14],
         Record.size() <= 16 ? true : Record[16],
         Record.size() <= 17 ? false : Record[17],
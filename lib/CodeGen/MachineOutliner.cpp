@@ -54,11 +54,18 @@
 /// For more information on the suffix tree data structure, please see
 /// https://www.cs.helsinki.fi/u/ukkonen/SuffixT1withFigs.pdf
 ///
+/// With -outliner-suffix-array, the repeated sequences are found with a suffix
+/// array and its LCP array instead, which need a few flat arrays rather than a
+/// node and a child map for every node of the tree.
+///
 //===----------------------------------------------------------------------===//
 #include "llvm/CodeGen/MachineOutliner.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
@@ -75,6 +82,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include <functional>
 #include <map>
+#include <numeric>
 #include <sstream>
 #include <tuple>
 #include <vector>
@@ -99,11 +107,38 @@ static cl::opt<bool> EnableLinkOnceODROutlining(
     cl::desc("Enable the machine outliner on linkonceodr functions"),
     cl::init(false));
 
+static cl::opt<unsigned> OutlinerReruns(
+    "machine-outliner-reruns", cl::Hidden,
+    cl::desc("Number of times to rerun the outliner on the code left by the "
+             "previous round"),
+    cl::init(0));
+
+static cl::opt<bool> OutlinerSkipHotBlocks(
+    "machine-outliner-skip-hot-blocks", cl::Hidden,
+    cl::desc("Don't outline from blocks that the profile summary says are "
+             "hot"),
+    cl::init(false));
+
+static cl::opt<bool> UseSuffixArray(
+    "outliner-suffix-array", cl::Hidden,
+    cl::desc("Find outlining candidates with a suffix array instead of a "
+             "suffix tree"),
+    cl::init(false));
+
 namespace {
 
 /// Represents an undefined index in the suffix tree.
 const unsigned EmptyIdx = -1;
 
+/// A substring that appears at least twice in the mapped module.
+struct RepeatedSubstring {
+  /// The length of the substring.
+  unsigned Length;
+
+  /// The start indices of its occurrences, in ascending order.
+  std::vector<unsigned> StartIndices;
+};
+
 /// A node in a suffix tree which represents a substring or suffix.
 ///
 /// Each node has either no children or at least two children, with the root
@@ -518,6 +553,186 @@ public:
     assert(Root && "Root node can't be nullptr!");
     setSuffixIndices(*Root, 0);
   }
+
+  /// Append the repeated substrings worth looking at to \p RS.
+  ///
+  /// If a substring appears at least twice, then it must be represented by
+  /// an internal node which appears in at least two suffixes. Each suffix is
+  /// represented by a leaf node. Each internal node with at least two leaf
+  /// children gives one substring, whose occurrences are the suffixes of those
+  /// leaves. The substrings are ordered by their first occurrence.
+  void findRepeatedSubstrings(std::vector<RepeatedSubstring> &RS) {
+    // FIXME: Visit internal nodes instead of leaves.
+    for (SuffixTreeNode *Leaf : LeafVector) {
+      assert(Leaf && "Leaves in LeafVector cannot be null!");
+      if (!Leaf->IsInTree)
+        continue;
+
+      assert(Leaf->Parent && "All leaves must have parents!");
+      SuffixTreeNode &Parent = *(Leaf->Parent);
+
+      // If it doesn't appear enough, or we already found it, skip it.
+      if (Parent.OccurrenceCount < 2 || Parent.isRoot() || !Parent.IsInTree)
+        continue;
+
+      // Too short to be beneficial; skip it.
+      // FIXME: This isn't necessarily true for, say, X86. If we factor in
+      // instruction lengths we need more information than this.
+      unsigned Length = Leaf->ConcatLen - (unsigned)Leaf->size();
+      if (Length < 2)
+        continue;
+
+      RS.emplace_back();
+      RS.back().Length = Length;
+      for (auto &ChildPair : Parent.Children) {
+        SuffixTreeNode *M = ChildPair.second;
+        if (M && M->IsInTree && M->isLeaf()) {
+          // Never visit this leaf again.
+          M->IsInTree = false;
+          RS.back().StartIndices.push_back(M->SuffixIdx);
+        }
+      }
+      llvm::sort(RS.back().StartIndices.begin(),
+                 RS.back().StartIndices.end());
+      Parent.IsInTree = false;
+    }
+  }
+};
+
+/// A suffix array for a sequence of unsigned integers, with the longest
+/// common prefix of each pair of neighbouring suffixes.
+///
+/// The suffixes that share a prefix of length at least D form a contiguous run
+/// of the array, bounded by LCPs below D. These runs are the internal nodes of
+/// the suffix tree of the same string, so the array finds the same repeated
+/// substrings as \p SuffixTree in about 16 bytes per integer, with no
+/// allocation per node.
+///
+/// The array is sorted by prefix doubling: each round orders the suffixes by
+/// their first 2K integers from the ranks of their first K and the K after,
+/// using two counting sorts. The LCPs are computed with Kasai's algorithm.
+class SuffixArray {
+  ArrayRef<unsigned> Str;
+
+  /// The start indices of the suffixes of \p Str in lexicographical order.
+  std::vector<unsigned> SA;
+
+  /// The length of the common prefix of the suffixes at SA[I - 1] and SA[I],
+  /// or 0 for I = 0.
+  std::vector<unsigned> LCP;
+
+public:
+  SuffixArray(ArrayRef<unsigned> Str) : Str(Str), SA(Str.size()) {
+    unsigned N = Str.size();
+    std::iota(SA.begin(), SA.end(), 0);
+    llvm::sort(SA.begin(), SA.end(),
+               [&](unsigned A, unsigned B) { return Str[A] < Str[B]; });
+
+    // The rank of each suffix among the prefixes sorted so far.
+    std::vector<unsigned> Rank(N), Tmp(N), Count;
+    unsigned MaxRank = 0;
+    for (unsigned I = 0; I != N; ++I) {
+      if (I && Str[SA[I]] != Str[SA[I - 1]])
+        ++MaxRank;
+      Rank[SA[I]] = MaxRank;
+    }
+
+    for (unsigned K = 1; N && MaxRank != N - 1; K *= 2) {
+      // Order the suffixes by the rank of their second half. Suffixes of at
+      // most K integers have an empty one and come first.
+      unsigned Pos = 0;
+      for (unsigned I = N - K; I != N; ++I)
+        Tmp[Pos++] = I;
+      for (unsigned I = 0; I != N; ++I)
+        if (SA[I] >= K)
+          Tmp[Pos++] = SA[I] - K;
+
+      // Stable sort that by the rank of the first half.
+      Count.assign(MaxRank + 1, 0);
+      for (unsigned I = 0; I != N; ++I)
+        ++Count[Rank[I]];
+      for (unsigned R = 1; R <= MaxRank; ++R)
+        Count[R] += Count[R - 1];
+      for (unsigned I = N; I-- != 0;)
+        SA[--Count[Rank[Tmp[I]]]] = Tmp[I];
+
+      auto getSecondRank = [&](unsigned I) {
+        return I + K < N ? Rank[I + K] + 1 : 0;
+      };
+      MaxRank = 0;
+      Tmp[SA[0]] = 0;
+      for (unsigned I = 1; I != N; ++I) {
+        if (Rank[SA[I]] != Rank[SA[I - 1]] ||
+            getSecondRank(SA[I]) != getSecondRank(SA[I - 1]))
+          ++MaxRank;
+        Tmp[SA[I]] = MaxRank;
+      }
+      Rank.swap(Tmp);
+    }
+
+    // The ranks are now the inverse of SA.
+    LCP.assign(N, 0);
+    for (unsigned I = 0, Len = 0; I != N; ++I) {
+      if (Rank[I] == 0) {
+        Len = 0;
+        continue;
+      }
+      unsigned Prev = SA[Rank[I] - 1];
+      while (I + Len < N && Prev + Len < N && Str[I + Len] == Str[Prev + Len])
+        ++Len;
+      LCP[Rank[I]] = Len;
+      if (Len)
+        --Len;
+    }
+  }
+
+  /// Append the same repeated substrings as
+  /// SuffixTree::findRepeatedSubstrings to \p RS, in the same order.
+  ///
+  /// This relies on \p Str ending in an integer that appears nowhere else, as
+  /// the outliner's mapping does, so that every suffix is a leaf.
+  void findRepeatedSubstrings(std::vector<RepeatedSubstring> &RS) const {
+    // Walk the internal nodes bottom-up. A suffix is a leaf child of the
+    // deepest node containing it, whose depth is the larger of its LCPs with
+    // its two neighbours. Each open node's leaf children are on the top of
+    // Leaves, above those of its ancestors.
+    struct OpenNode {
+      unsigned Depth;
+      unsigned FirstLeaf;
+    };
+    SmallVector<OpenNode, 32> Stack;
+    std::vector<unsigned> Leaves;
+    size_t FirstNew = RS.size();
+
+    Stack.push_back({0, 0});
+    for (unsigned I = 0, N = SA.size(); I != N; ++I) {
+      unsigned NextLCP = I + 1 != N ? LCP[I + 1] : 0;
+      if (NextLCP > Stack.back().Depth)
+        Stack.push_back({NextLCP, (unsigned)Leaves.size()});
+      Leaves.push_back(SA[I]);
+
+      // Close the nodes that don't contain the next suffix.
+      while (Stack.back().Depth > NextLCP) {
+        OpenNode Node = Stack.pop_back_val();
+        if (Node.Depth >= 2 && Leaves.size() - Node.FirstLeaf >= 2) {
+          RS.emplace_back();
+          RS.back().Length = Node.Depth;
+          RS.back().StartIndices.assign(Leaves.begin() + Node.FirstLeaf,
+                                        Leaves.end());
+          llvm::sort(RS.back().StartIndices.begin(),
+                     RS.back().StartIndices.end());
+        }
+        Leaves.resize(Node.FirstLeaf);
+        if (Stack.back().Depth < NextLCP)
+          Stack.push_back({NextLCP, (unsigned)Leaves.size()});
+      }
+    }
+
+    std::sort(RS.begin() + FirstNew, RS.end(),
+              [](const RepeatedSubstring &A, const RepeatedSubstring &B) {
+                return A.StartIndices.front() < B.StartIndices.front();
+              });
+  }
 };
 
 /// Maps \p MachineInstrs to unsigned integers and stores the mappings.
@@ -697,11 +912,23 @@ struct MachineOutliner : public ModulePass {
   // Collection of IR functions created by the outliner.
   std::vector<Function *> CreatedIRFunctions;
 
+  /// The same functions as \p CreatedIRFunctions, for lookups. Outlined
+  /// functions don't track liveness, so they are never outlined from.
+  SmallPtrSet<const Function *, 16> CreatedIRFunctionSet;
+
+  /// The number of outlining rounds done so far in this module. Names of
+  /// functions outlined after the first round include the round.
+  unsigned OutlineRound = 0;
+
   StringRef getPassName() const override { return "Machine Outliner"; }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<MachineModuleInfo>();
     AU.addPreserved<MachineModuleInfo>();
+    if (OutlinerSkipHotBlocks) {
+      AU.addRequired<ProfileSummaryInfoWrapperPass>();
+      AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    }
     AU.setPreservesAll();
     ModulePass::getAnalysisUsage(AU);
   }
@@ -712,14 +939,7 @@ struct MachineOutliner : public ModulePass {
 
   /// Find all repeated substrings that satisfy the outlining cost model.
   ///
-  /// If a substring appears at least twice, then it must be represented by
-  /// an internal node which appears in at least two suffixes. Each suffix is
-  /// represented by a leaf node. To do this, we visit each internal node in
-  /// the tree, using the leaf children of each internal node. If an internal
-  /// node represents a beneficial substring, then we use each of its leaf
-  /// children to find the locations of its substring.
-  ///
-  /// \param ST A suffix tree to query.
+  /// \param RepeatedSubstrings The repeated substrings of the module.
   /// \param TII TargetInstrInfo for the target.
   /// \param Mapper Contains outlining mapping information.
   /// \param[out] CandidateList Filled with candidates representing each
@@ -729,8 +949,8 @@ struct MachineOutliner : public ModulePass {
   ///
   /// \returns The length of the longest candidate found.
   unsigned
-  findCandidates(SuffixTree &ST, const TargetInstrInfo &TII,
-                 InstructionMapper &Mapper,
+  findCandidates(ArrayRef<RepeatedSubstring> RepeatedSubstrings,
+                 const TargetInstrInfo &TII, InstructionMapper &Mapper,
                  std::vector<std::shared_ptr<Candidate>> &CandidateList,
                  std::vector<OutlinedFunction> &FunctionList);
 
@@ -760,15 +980,15 @@ struct MachineOutliner : public ModulePass {
   /// \param[out] CandidateList Filled with outlining candidates for the module.
   /// \param[out] FunctionList Filled with functions corresponding to each type
   /// of \p Candidate.
-  /// \param ST The suffix tree for the module.
+  /// \param RepeatedSubstrings The repeated substrings of the module.
   /// \param TII TargetInstrInfo for the module.
   ///
   /// \returns The length of the longest candidate found. 0 if there are none.
   unsigned
   buildCandidateList(std::vector<std::shared_ptr<Candidate>> &CandidateList,
                      std::vector<OutlinedFunction> &FunctionList,
-                     SuffixTree &ST, InstructionMapper &Mapper,
-                     const TargetInstrInfo &TII);
+                     ArrayRef<RepeatedSubstring> RepeatedSubstrings,
+                     InstructionMapper &Mapper, const TargetInstrInfo &TII);
 
   /// Helper function for pruneOverlaps.
   /// Removes \p C from the candidate list, and updates its \p OutlinedFunction.
@@ -792,8 +1012,13 @@ struct MachineOutliner : public ModulePass {
                      InstructionMapper &Mapper, unsigned MaxCandidateLen,
                      const TargetInstrInfo &TII);
 
-  /// Construct a suffix tree on the instructions in \p M and outline repeated
-  /// strings from that tree.
+  /// Map the instructions of \p M to a string, find its repeated substrings
+  /// and outline the beneficial ones. Returns true if anything was outlined.
+  bool doOutline(Module &M, const TargetInstrInfo &TII,
+                 const TargetRegisterInfo &TRI);
+
+  /// Outline repeated sequences of instructions in \p M, in up to
+  /// 1 + -machine-outliner-reruns rounds.
   bool runOnModule(Module &M) override;
 
   /// Return a DISubprogram for OF if one exists, and null otherwise. Helper
@@ -820,91 +1045,70 @@ ModulePass *createMachineOutlinerPass(bool RunOnAllFunctions) {
 
 } // namespace llvm
 
-INITIALIZE_PASS(MachineOutliner, DEBUG_TYPE, "Machine Function Outliner", false,
-                false)
+INITIALIZE_PASS_BEGIN(MachineOutliner, DEBUG_TYPE, "Machine Function Outliner",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_END(MachineOutliner, DEBUG_TYPE, "Machine Function Outliner",
+                    false, false)
 
 unsigned MachineOutliner::findCandidates(
-    SuffixTree &ST, const TargetInstrInfo &TII, InstructionMapper &Mapper,
+    ArrayRef<RepeatedSubstring> RepeatedSubstrings, const TargetInstrInfo &TII,
+    InstructionMapper &Mapper,
     std::vector<std::shared_ptr<Candidate>> &CandidateList,
     std::vector<OutlinedFunction> &FunctionList) {
   CandidateList.clear();
   FunctionList.clear();
   unsigned MaxLen = 0;
 
-  // FIXME: Visit internal nodes instead of leaves.
-  for (SuffixTreeNode *Leaf : ST.LeafVector) {
-    assert(Leaf && "Leaves in LeafVector cannot be null!");
-    if (!Leaf->IsInTree)
-      continue;
-
-    assert(Leaf->Parent && "All leaves must have parents!");
-    SuffixTreeNode &Parent = *(Leaf->Parent);
-
-    // If it doesn't appear enough, or we already outlined from it, skip it.
-    if (Parent.OccurrenceCount < 2 || Parent.isRoot() || !Parent.IsInTree)
-      continue;
-
-    // Figure out if this candidate is beneficial.
-    unsigned StringLen = Leaf->ConcatLen - (unsigned)Leaf->size();
-
-    // Too short to be beneficial; skip it.
-    // FIXME: This isn't necessarily true for, say, X86. If we factor in
-    // instruction lengths we need more information than this.
-    if (StringLen < 2)
-      continue;
+  for (const RepeatedSubstring &RS : RepeatedSubstrings) {
+    unsigned StringLen = RS.Length;
 
     // If this is a beneficial class of candidate, then every one is stored in
     // this vector.
     std::vector<Candidate> CandidatesForRepeatedSeq;
 
     // Figure out the call overhead for each instance of the sequence.
-    for (auto &ChildPair : Parent.Children) {
-      SuffixTreeNode *M = ChildPair.second;
-
-      if (M && M->IsInTree && M->isLeaf()) {
-        // Never visit this leaf again.
-        M->IsInTree = false;
-        unsigned StartIdx = M->SuffixIdx;
-        unsigned EndIdx = StartIdx + StringLen - 1;
-
-        // Trick: Discard some candidates that would be incompatible with the
-        // ones we've already found for this sequence. This will save us some
-        // work in candidate selection.
-        //
-        // If two candidates overlap, then we can't outline them both. This
-        // happens when we have candidates that look like, say
-        //
-        // AA (where each "A" is an instruction).
-        //
-        // We might have some portion of the module that looks like this:
-        // AAAAAA (6 A's) 
-        //
-        // In this case, there are 5 different copies of "AA" in this range, but
-        // at most 3 can be outlined. If only outlining 3 of these is going to
-        // be unbeneficial, then we ought to not bother.
-        //
-        // Note that two things DON'T overlap when they look like this:
-        // start1...end1 .... start2...end2
-        // That is, one must either
-        // * End before the other starts
-        // * Start after the other ends
-        if (std::all_of(CandidatesForRepeatedSeq.begin(),
-                        CandidatesForRepeatedSeq.end(),
-                        [&StartIdx, &EndIdx](const Candidate &C) {
-                          return (EndIdx < C.getStartIdx() ||
-                                  StartIdx > C.getEndIdx());
-                        })) {
-          // It doesn't overlap with anything, so we can outline it.
-          // Each sequence is over [StartIt, EndIt].
-          // Save the candidate and its location.
-
-          MachineBasicBlock::iterator StartIt = Mapper.InstrList[StartIdx];
-          MachineBasicBlock::iterator EndIt = Mapper.InstrList[EndIdx];
-
-          CandidatesForRepeatedSeq.emplace_back(StartIdx, StringLen, StartIt,
-                                                EndIt, StartIt->getParent(),
-                                                FunctionList.size());
-        }
+    for (unsigned StartIdx : RS.StartIndices) {
+      unsigned EndIdx = StartIdx + StringLen - 1;
+
+      // Trick: Discard some candidates that would be incompatible with the
+      // ones we've already found for this sequence. This will save us some
+      // work in candidate selection.
+      //
+      // If two candidates overlap, then we can't outline them both. This
+      // happens when we have candidates that look like, say
+      //
+      // AA (where each "A" is an instruction).
+      //
+      // We might have some portion of the module that looks like this:
+      // AAAAAA (6 A's)
+      //
+      // In this case, there are 5 different copies of "AA" in this range, but
+      // at most 3 can be outlined. If only outlining 3 of these is going to
+      // be unbeneficial, then we ought to not bother.
+      //
+      // Note that two things DON'T overlap when they look like this:
+      // start1...end1 .... start2...end2
+      // That is, one must either
+      // * End before the other starts
+      // * Start after the other ends
+      if (std::all_of(CandidatesForRepeatedSeq.begin(),
+                      CandidatesForRepeatedSeq.end(),
+                      [&StartIdx, &EndIdx](const Candidate &C) {
+                        return (EndIdx < C.getStartIdx() ||
+                                StartIdx > C.getEndIdx());
+                      })) {
+        // It doesn't overlap with anything, so we can outline it.
+        // Each sequence is over [StartIt, EndIt].
+        // Save the candidate and its location.
+
+        MachineBasicBlock::iterator StartIt = Mapper.InstrList[StartIdx];
+        MachineBasicBlock::iterator EndIt = Mapper.InstrList[EndIdx];
+
+        CandidatesForRepeatedSeq.emplace_back(StartIdx, StringLen, StartIt,
+                                              EndIt, StartIt->getParent(),
+                                              FunctionList.size());
       }
     }
 
@@ -914,8 +1118,9 @@ unsigned MachineOutliner::findCandidates(
     TargetCostInfo TCI =
         TII.getOutliningCandidateInfo(CandidatesForRepeatedSeq);
     std::vector<unsigned> Seq;
-    for (unsigned i = Leaf->SuffixIdx; i < Leaf->SuffixIdx + StringLen; i++)
-      Seq.push_back(ST.Str[i]);
+    unsigned FirstIdx = RS.StartIndices.front();
+    for (unsigned i = FirstIdx; i < FirstIdx + StringLen; i++)
+      Seq.push_back(Mapper.UnsignedVec[i]);
     OutlinedFunction OF(FunctionList.size(), CandidatesForRepeatedSeq.size(),
                         Seq, TCI);
     unsigned Benefit = OF.getBenefit();
@@ -971,9 +1176,6 @@ unsigned MachineOutliner::findCandidates(
 
     FunctionList.push_back(OF);
     FunctionList.back().Candidates = CandidatesForFn;
-
-    // Move to the next function.
-    Parent.IsInTree = false;
   }
 
   return MaxLen;
@@ -1091,14 +1293,15 @@ void MachineOutliner::pruneOverlaps(
 
 unsigned MachineOutliner::buildCandidateList(
     std::vector<std::shared_ptr<Candidate>> &CandidateList,
-    std::vector<OutlinedFunction> &FunctionList, SuffixTree &ST,
-    InstructionMapper &Mapper, const TargetInstrInfo &TII) {
+    std::vector<OutlinedFunction> &FunctionList,
+    ArrayRef<RepeatedSubstring> RepeatedSubstrings, InstructionMapper &Mapper,
+    const TargetInstrInfo &TII) {
 
   std::vector<unsigned> CandidateSequence; // Current outlining candidate.
   unsigned MaxCandidateLen = 0;            // Length of the longest candidate.
 
-  MaxCandidateLen =
-      findCandidates(ST, TII, Mapper, CandidateList, FunctionList);
+  MaxCandidateLen = findCandidates(RepeatedSubstrings, TII, Mapper,
+                                   CandidateList, FunctionList);
 
   // Sort the candidates in decending order. This will simplify the outlining
   // process when we have to remove the candidates from the mapping by
@@ -1119,7 +1322,10 @@ MachineOutliner::createOutlinedFunction(Module &M, const OutlinedFunction &OF,
   // module name and include it in the function name plus the number of this
   // function.
   std::ostringstream NameStream;
-  NameStream << "OUTLINED_FUNCTION_" << OF.Name;
+  NameStream << "OUTLINED_FUNCTION_";
+  if (OutlineRound > 0)
+    NameStream << OutlineRound << "_";
+  NameStream << OF.Name;
 
   // Create the function using an IR-level function.
   LLVMContext &C = M.getContext();
@@ -1142,6 +1348,7 @@ MachineOutliner::createOutlinedFunction(Module &M, const OutlinedFunction &OF,
 
   // Save F so that we can add debug info later if we need to.
   CreatedIRFunctions.push_back(F);
+  CreatedIRFunctionSet.insert(F);
 
   BasicBlock *EntryBB = BasicBlock::Create(C, "entry", F);
   IRBuilder<> Builder(EntryBB);
@@ -1357,6 +1564,28 @@ bool MachineOutliner::runOnModule(Module &M) {
   // it here.
   OutlineFromLinkOnceODRs = EnableLinkOnceODROutlining;
 
+  // Each round after the first works on the code the previous one left, where
+  // calls to outlined functions can make up new repeated sequences.
+  bool Changed = false;
+  for (OutlineRound = 0; OutlineRound <= OutlinerReruns; ++OutlineRound) {
+    LLVM_DEBUG(dbgs() << "Machine Outliner: Round " << OutlineRound << "\n");
+    if (!doOutline(M, *TII, *TRI))
+      break;
+    Changed = true;
+  }
+  return Changed;
+}
+
+bool MachineOutliner::doOutline(Module &M, const TargetInstrInfo &TII,
+                                const TargetRegisterInfo &TRI) {
+  MachineModuleInfo &MMI = getAnalysis<MachineModuleInfo>();
+  ProfileSummaryInfo *PSI = nullptr;
+  if (OutlinerSkipHotBlocks) {
+    PSI = getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+    if (!PSI->hasProfileSummary())
+      PSI = nullptr;
+  }
+
   InstructionMapper Mapper;
 
   // Build instruction mappings for each function in the module. Start by
@@ -1377,14 +1606,24 @@ bool MachineOutliner::runOnModule(Module &M) {
     if (!MF)
       continue;
 
-    if (!RunOnAllFunctions && !TII->shouldOutlineFromFunctionByDefault(*MF))
+    // Don't outline from functions outlined by an earlier round.
+    if (CreatedIRFunctionSet.count(&F))
+      continue;
+
+    if (!RunOnAllFunctions && !TII.shouldOutlineFromFunctionByDefault(*MF))
       continue;
 
     // We have a MachineFunction. Ask the target if it's suitable for outlining.
     // If it isn't, then move on to the next Function in the module.
-    if (!TII->isFunctionSafeToOutlineFrom(*MF, OutlineFromLinkOnceODRs))
+    if (!TII.isFunctionSafeToOutlineFrom(*MF, OutlineFromLinkOnceODRs))
       continue;
 
+    // With a profile, leave the hot blocks alone: calling an outlined
+    // sequence costs a call and a return every time it runs.
+    BlockFrequencyInfo *BFI = nullptr;
+    if (PSI)
+      BFI = &getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+
     // We have a function suitable for outlining. Iterate over every
     // MachineBasicBlock in MF and try to map its instructions to a list of
     // unsigned integers.
@@ -1399,22 +1638,37 @@ bool MachineOutliner::runOnModule(Module &M) {
       if (MBB.hasAddressTaken())
         continue;
 
+      // Blocks made by codegen have no IR block to take a frequency from;
+      // they are outlined from like any other.
+      if (BFI && MBB.getBasicBlock() &&
+          PSI->isHotBB(MBB.getBasicBlock(), BFI))
+        continue;
+
       // MBB is suitable for outlining. Map it to a list of unsigneds.
-      Mapper.convertToUnsignedVec(MBB, *TRI, *TII);
+      Mapper.convertToUnsignedVec(MBB, TRI, TII);
     }
   }
 
-  // Construct a suffix tree, use it to find candidates, and then outline them.
-  SuffixTree ST(Mapper.UnsignedVec);
+  // Find the repeated substrings of the mapped module. The suffix structure
+  // is freed before the candidates are built.
+  std::vector<RepeatedSubstring> RepeatedSubstrings;
+  if (UseSuffixArray) {
+    SuffixArray SA(Mapper.UnsignedVec);
+    SA.findRepeatedSubstrings(RepeatedSubstrings);
+  } else {
+    SuffixTree ST(Mapper.UnsignedVec);
+    ST.findRepeatedSubstrings(RepeatedSubstrings);
+  }
+
   std::vector<std::shared_ptr<Candidate>> CandidateList;
   std::vector<OutlinedFunction> FunctionList;
 
   // Find all of the outlining candidates.
-  unsigned MaxCandidateLen =
-      buildCandidateList(CandidateList, FunctionList, ST, Mapper, *TII);
+  unsigned MaxCandidateLen = buildCandidateList(
+      CandidateList, FunctionList, RepeatedSubstrings, Mapper, TII);
 
   // Remove candidates that overlap with other candidates.
-  pruneOverlaps(CandidateList, FunctionList, Mapper, MaxCandidateLen, *TII);
+  pruneOverlaps(CandidateList, FunctionList, Mapper, MaxCandidateLen, TII);
 
   // Outline each of the candidates and return true if something was outlined.
   bool OutlinedSomething = outline(M, CandidateList, FunctionList, Mapper);
@@ -85,6 +85,8 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumGrowRegionBailouts,
+          "Number of split candidates given up by growRegion");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -137,6 +139,13 @@ static cl::opt<bool> ConsiderLocalIntervalCost(
              "candidate when choosing the best split candidate."),
     cl::init(false));
 
+static cl::opt<unsigned> GrowRegionComplexityBudget(
+    "grow-region-complexity-budget", cl::Hidden,
+    cl::desc("Maximum number of bundle blocks growRegion() looks at for a "
+             "single split candidate before giving the candidate up "
+             "(0 = unlimited)"),
+    cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -444,7 +453,7 @@ private:
   BlockFrequency calcSpillCost();
   bool addSplitConstraints(InterferenceCache::Cursor, BlockFrequency&);
   void addThroughConstraints(InterferenceCache::Cursor, ArrayRef<unsigned>);
-  void growRegion(GlobalSplitCandidate &Cand);
+  bool growRegion(GlobalSplitCandidate &Cand);
   bool splitCanCauseEvictionChain(unsigned Evictee, GlobalSplitCandidate &Cand,
                                   unsigned BBNumber,
                                   const AllocationOrder &Order);
@@ -1271,7 +1280,11 @@ void RAGreedy::addThroughConstraints(InterferenceCache::Cursor Intf,
   SpillPlacer->addLinks(makeArrayRef(TBS, T));
 }
 
-void RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
+/// growRegion - Grow the region of live bundles from the positive bundles the
+/// spill placer found so far. Returns false if the region could not be
+/// computed within a nonzero GrowRegionComplexityBudget, in which case the
+/// candidate should be discarded.
+bool RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
   // Keep track of through blocks that have not been added to SpillPlacer.
   BitVector Todo = SA->getThroughBlocks();
   SmallVectorImpl<unsigned> &ActiveBlocks = Cand.ActiveBlocks;
@@ -1280,6 +1293,11 @@ void RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
   unsigned Visited = 0;
 #endif
 
+  // Every bundle that turns positive has all of its blocks scanned, and in a
+  // huge function with many through blocks the region can keep growing for a
+  // long time. This cost is paid again for every physreg candidate, so it can
+  // be capped.
+  unsigned Budget = GrowRegionComplexityBudget;
   while (true) {
     ArrayRef<unsigned> NewBundles = SpillPlacer->getRecentPositive();
     // Find new through blocks in the periphery of PrefRegBundles.
@@ -1287,6 +1305,13 @@ void RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
       unsigned Bundle = NewBundles[i];
       // Look at all blocks connected to Bundle in the full graph.
       ArrayRef<unsigned> Blocks = Bundles->getBlocks(Bundle);
+      if (GrowRegionComplexityBudget) {
+        if (Blocks.size() > Budget) {
+          ++NumGrowRegionBailouts;
+          return false;
+        }
+        Budget -= Blocks.size();
+      }
       for (ArrayRef<unsigned>::iterator I = Blocks.begin(), E = Blocks.end();
            I != E; ++I) {
         unsigned Block = *I;
@@ -1319,6 +1344,7 @@ void RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
     SpillPlacer->iterate();
   }
   LLVM_DEBUG(dbgs() << ", v=" << Visited);
+  return true;
 }
 
 /// calcCompactRegion - Compute the set of edge bundles that should be live
@@ -1349,7 +1375,10 @@ bool RAGreedy::calcCompactRegion(GlobalSplitCandidate &Cand) {
     return false;
   }
 
-  growRegion(Cand);
+  if (!growRegion(Cand)) {
+    LLVM_DEBUG(dbgs() << ", over the complexity budget.\n");
+    return false;
+  }
   SpillPlacer->finish();
 
   if (!Cand.LiveBundles.any()) {
@@ -1866,7 +1895,10 @@ unsigned RAGreedy::calculateRegionSplitCost(LiveInterval &VirtReg,
       });
       continue;
     }
-    growRegion(Cand);
+    if (!growRegion(Cand)) {
+      LLVM_DEBUG(dbgs() << ", over the complexity budget.\n");
+      continue;
+    }
 
     SpillPlacer->finish();
 
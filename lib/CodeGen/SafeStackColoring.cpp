@@ -12,6 +12,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/CodeGen/BitVectorDataflow.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
@@ -161,45 +162,34 @@ void StackColoring::collectMarkers() {
 }
 
 void StackColoring::calculateLocalLiveness() {
-  bool changed = true;
-  while (changed) {
-    changed = false;
-
-    for (BasicBlock *BB : depth_first(&F)) {
-      BlockLifetimeInfo &BlockInfo = BlockLiveness[BB];
-
-      // Compute LiveIn by unioning together the LiveOut sets of all preds.
-      BitVector LocalLiveIn;
-      for (auto *PredBB : predecessors(BB)) {
-        LivenessMap::const_iterator I = BlockLiveness.find(PredBB);
-        assert(I != BlockLiveness.end() && "Predecessor not found");
-        LocalLiveIn |= I->second.LiveOut;
-      }
+  // An alloca is live out of a block if it is live into it and its lifetime
+  // doesn't end in it, or if its lifetime begins in it. If we have both BEGIN
+  // and END markers in the same basic block then we know that the BEGIN
+  // marker comes after the END, because we already handle the case where the
+  // BEGIN comes before the END when collecting the markers (and building the
+  // BEGIN/END vectors).
+  BitVectorDataflow<Function *> Dataflow(&F);
+  for (BasicBlock *BB : Dataflow.blocks()) {
+    LivenessMap::iterator I = BlockLiveness.find(BB);
+    assert(I != BlockLiveness.end() && "Block not found");
+    BlockLifetimeInfo &BlockInfo = I->second;
+    auto &Sets = Dataflow[BB];
+    std::swap(Sets.Gen, BlockInfo.Begin);
+    std::swap(Sets.Kill, BlockInfo.End);
+    std::swap(Sets.In, BlockInfo.LiveIn);
+    std::swap(Sets.Out, BlockInfo.LiveOut);
+  }
 
-      // Compute LiveOut by subtracting out lifetimes that end in this
-      // block, then adding in lifetimes that begin in this block.  If
-      // we have both BEGIN and END markers in the same basic block
-      // then we know that the BEGIN marker comes after the END,
-      // because we already handle the case where the BEGIN comes
-      // before the END when collecting the markers (and building the
-      // BEGIN/END vectors).
-      BitVector LocalLiveOut = LocalLiveIn;
-      LocalLiveOut.reset(BlockInfo.End);
-      LocalLiveOut |= BlockInfo.Begin;
-
-      // Update block LiveIn set, noting whether it has changed.
-      if (LocalLiveIn.test(BlockInfo.LiveIn)) {
-        changed = true;
-        BlockInfo.LiveIn |= LocalLiveIn;
-      }
+  Dataflow.solve();
 
-      // Update block LiveOut set, noting whether it has changed.
-      if (LocalLiveOut.test(BlockInfo.LiveOut)) {
-        changed = true;
-        BlockInfo.LiveOut |= LocalLiveOut;
-      }
-    }
-  } // while changed.
+  for (BasicBlock *BB : Dataflow.blocks()) {
+    BlockLifetimeInfo &BlockInfo = BlockLiveness[BB];
+    auto &Sets = Dataflow[BB];
+    std::swap(Sets.Gen, BlockInfo.Begin);
+    std::swap(Sets.Kill, BlockInfo.End);
+    std::swap(Sets.In, BlockInfo.LiveIn);
+    std::swap(Sets.Out, BlockInfo.LiveOut);
+  }
 }
 
 void StackColoring::calculateLiveIntervals() {
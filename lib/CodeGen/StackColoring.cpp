@@ -28,6 +28,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/CodeGen/BitVectorDataflow.h"
 #include "llvm/CodeGen/LiveInterval.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
@@ -765,56 +766,34 @@ unsigned StackColoring::collectMarkers(unsigned NumSlot) {
 }
 
 void StackColoring::calculateLocalLiveness() {
-  unsigned NumIters = 0;
-  bool changed = true;
-  while (changed) {
-    changed = false;
-    ++NumIters;
-
-    for (const MachineBasicBlock *BB : BasicBlockNumbering) {
-      // Use an iterator to avoid repeated lookups.
-      LivenessMap::iterator BI = BlockLiveness.find(BB);
-      assert(BI != BlockLiveness.end() && "Block not found");
-      BlockLifetimeInfo &BlockInfo = BI->second;
-
-      // Compute LiveIn by unioning together the LiveOut sets of all preds.
-      BitVector LocalLiveIn;
-      for (MachineBasicBlock::const_pred_iterator PI = BB->pred_begin(),
-           PE = BB->pred_end(); PI != PE; ++PI) {
-        LivenessMap::const_iterator I = BlockLiveness.find(*PI);
-        // PR37130: transformations prior to stack coloring can
-        // sometimes leave behind statically unreachable blocks; these
-        // can be safely skipped here.
-        if (I != BlockLiveness.end())
-          LocalLiveIn |= I->second.LiveOut;
-      }
+  // A slot is live out of a block if it is live into it and doesn't END in
+  // it, or if it BEGINs in it. If we have both BEGIN and END markers in the
+  // same basic block then we know that the BEGIN marker comes after the END,
+  // because we already handle the case where the BEGIN comes before the END
+  // when collecting the markers (and building the BEGIN/END vectors).
+  //
+  // Only the blocks reachable from the entry are in BlockLiveness, so the
+  // dataflow skips any statically unreachable predecessors (PR37130).
+  BitVectorDataflow<MachineFunction *> Dataflow(MF);
+  for (MachineBasicBlock *MBB : Dataflow.blocks()) {
+    BlockLifetimeInfo &BlockInfo = BlockLiveness[MBB];
+    auto &Sets = Dataflow[MBB];
+    std::swap(Sets.Gen, BlockInfo.Begin);
+    std::swap(Sets.Kill, BlockInfo.End);
+    std::swap(Sets.In, BlockInfo.LiveIn);
+    std::swap(Sets.Out, BlockInfo.LiveOut);
+  }
 
-      // Compute LiveOut by subtracting out lifetimes that end in this
-      // block, then adding in lifetimes that begin in this block.  If
-      // we have both BEGIN and END markers in the same basic block
-      // then we know that the BEGIN marker comes after the END,
-      // because we already handle the case where the BEGIN comes
-      // before the END when collecting the markers (and building the
-      // BEGIN/END vectors).
-      BitVector LocalLiveOut = LocalLiveIn;
-      LocalLiveOut.reset(BlockInfo.End);
-      LocalLiveOut |= BlockInfo.Begin;
-
-      // Update block LiveIn set, noting whether it has changed.
-      if (LocalLiveIn.test(BlockInfo.LiveIn)) {
-        changed = true;
-        BlockInfo.LiveIn |= LocalLiveIn;
-      }
+  NumIterations = Dataflow.solve();
 
-      // Update block LiveOut set, noting whether it has changed.
-      if (LocalLiveOut.test(BlockInfo.LiveOut)) {
-        changed = true;
-        BlockInfo.LiveOut |= LocalLiveOut;
-      }
-    }
-  } // while changed.
-
-  NumIterations = NumIters;
+  for (MachineBasicBlock *MBB : Dataflow.blocks()) {
+    BlockLifetimeInfo &BlockInfo = BlockLiveness[MBB];
+    auto &Sets = Dataflow[MBB];
+    std::swap(Sets.Gen, BlockInfo.Begin);
+    std::swap(Sets.Kill, BlockInfo.End);
+    std::swap(Sets.In, BlockInfo.LiveIn);
+    std::swap(Sets.Out, BlockInfo.LiveOut);
+  }
 }
 
 void StackColoring::calculateLiveIntervals(unsigned NumSlots) {
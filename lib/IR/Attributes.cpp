@@ -81,6 +81,7 @@ unpackAllocSizeArgs(uint64_t Num) {
 Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
                          uint64_t Val) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   FoldingSetNodeID ID;
   ID.AddInteger(Kind);
   if (Val) ID.AddInteger(Val);
@@ -104,6 +105,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
 
 Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   FoldingSetNodeID ID;
   ID.AddString(Kind);
   if (!Val.empty()) ID.AddString(Val);
@@ -653,6 +655,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
 
   // Otherwise, build a key to look up the existing attributes.
   LLVMContextImpl *pImpl = C.pImpl;
+  ContextLock Lock(*pImpl);
   FoldingSetNodeID ID;
 
   SmallVector<Attribute, 8> SortedAttrs(Attrs.begin(), Attrs.end());
@@ -846,6 +849,7 @@ AttributeList AttributeList::getImpl(LLVMContext &C,
   assert(!AttrSets.empty() && "pointless AttributeListImpl");
 
   LLVMContextImpl *pImpl = C.pImpl;
+  ContextLock Lock(*pImpl);
   FoldingSetNodeID ID;
   AttributeListImpl::Profile(ID, AttrSets);
 
@@ -359,6 +359,7 @@ Constant *Constant::getAggregateElement(Constant *Elt) const {
 }
 
 void Constant::destroyConstant() {
+  ContextLock Lock(getContext());
   /// First call destroyConstantImpl on the subclass.  This gives the subclass
   /// a chance to remove the constant from any maps/pools it's contained in.
   switch (getValueID()) {
@@ -576,6 +577,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt &V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -583,6 +585,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -608,6 +611,7 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   std::unique_ptr<ConstantInt> &Slot = pImpl->IntConstants[V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
@@ -756,6 +760,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
 
   std::unique_ptr<ConstantFP> &Slot = pImpl->FPConstants[V];
 
@@ -1106,6 +1111,7 @@ Constant *ConstantVector::getSplat(unsigned NumElts, Constant *V) {
 
 ConstantTokenNone *ConstantTokenNone::get(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   if (!pImpl->TheNoneToken)
     pImpl->TheNoneToken.reset(new ConstantTokenNone(Context));
   return pImpl->TheNoneToken.get();
@@ -1310,6 +1316,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
 
+  ContextLock Lock(Ty->getContext());
   std::unique_ptr<ConstantAggregateZero> &Entry =
       Ty->getContext().pImpl->CAZConstants[Ty];
   if (!Entry)
@@ -1376,6 +1383,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  ContextLock Lock(Ty->getContext());
   std::unique_ptr<ConstantPointerNull> &Entry =
       Ty->getContext().pImpl->CPNConstants[Ty];
   if (!Entry)
@@ -1390,6 +1398,7 @@ void ConstantPointerNull::destroyConstantImpl() {
 }
 
 UndefValue *UndefValue::get(Type *Ty) {
+  ContextLock Lock(Ty->getContext());
   std::unique_ptr<UndefValue> &Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (!Entry)
     Entry.reset(new UndefValue(Ty));
@@ -1409,6 +1418,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  ContextLock Lock(F->getContext());
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (!BA)
@@ -1432,6 +1442,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
+  ContextLock Lock(F->getContext());
   BlockAddress *BA =
       F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
@@ -2427,6 +2438,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  ContextLock Lock(Ty->getContext());
   auto &Slot =
       *Ty->getContext()
            .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
@@ -2763,6 +2775,7 @@ Constant *ConstantDataVector::getSplatValue() const {
 /// array instance.
 ///
 void Constant::handleOperandChange(Value *From, Value *To) {
+  ContextLock Lock(getContext());
   Value *Replacement = nullptr;
   switch (getValueID()) {
   default:
@@ -15,6 +15,7 @@
 #ifndef LLVM_LIB_IR_CONSTANTSCONTEXT_H
 #define LLVM_LIB_IR_CONSTANTSCONTEXT_H
 
+#include "ContextLock.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/DenseSet.h"
@@ -643,6 +644,7 @@ private:
 public:
   /// Return the specified constant from the map, creating it if necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, ValType V) {
+    ContextLock Lock(Ty->getContext());
     LookupKey Key(Ty, V);
     /// Hash once, and reuse it for the lookup and the insertion if needed.
     LookupKeyHashed Lookup(MapInfo::getHashValue(Key), Key);
@@ -661,6 +663,7 @@ public:
 
   /// Remove this constant from the map
   void remove(ConstantClass *CP) {
+    ContextLock Lock(CP->getContext());
     typename MapTy::iterator I = Map.find(CP);
     assert(I != Map.end() && "Constant not found in constant table!");
     assert(*I == CP && "Didn't find correct element?");
@@ -671,6 +674,7 @@ public:
                                         ConstantClass *CP, Value *From,
                                         Constant *To, unsigned NumUpdated = 0,
                                         unsigned OperandNo = ~0u) {
+    ContextLock Lock(CP->getContext());
     LookupKey Key(CP->getType(), ValType(Operands, CP));
     /// Hash once, and reuse it for the lookup and the insertion if needed.
     LookupKeyHashed Lookup(MapInfo::getHashValue(Key), Key);
@@ -0,0 +1,51 @@
+//===- ContextLock.h - Guard for the shared state of a context --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares ContextLock, which serializes accesses to the tables
+/// an LLVMContext shares between all of its modules and functions while the
+/// context is in concurrent mode.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_IR_CONTEXTLOCK_H
+#define LLVM_LIB_IR_CONTEXTLOCK_H
+
+#include <mutex>
+
+namespace llvm {
+
+class LLVMContext;
+class LLVMContextImpl;
+
+/// Holds the lock of a context until the end of the enclosing scope if the
+/// context is in concurrent mode, and does nothing otherwise.
+///
+/// The lock is recursive, since uniquing one object commonly looks up or
+/// creates others (the operands of a constant expression, its type, ...).
+///
+/// The constructors are defined inline in LLVMContextImpl.h, so that outside
+/// of concurrent mode taking the lock costs a single predictable branch.
+class ContextLock {
+  std::recursive_mutex *Mutex = nullptr;
+
+public:
+  inline explicit ContextLock(const LLVMContextImpl &CImpl);
+  inline explicit ContextLock(const LLVMContext &C);
+  ContextLock(const ContextLock &) = delete;
+  ContextLock &operator=(const ContextLock &) = delete;
+  ~ContextLock() {
+    if (Mutex)
+      Mutex->unlock();
+  }
+};
+
+} // end namespace llvm
+
+#endif // LLVM_LIB_IR_CONTEXTLOCK_H
@@ -48,6 +48,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   // Fixup column.
   adjustColumn(Column);
 
+  ContextLock Lock(Context);
   if (Storage == Uniqued) {
     if (auto *N =
             getUniqued(Context.pImpl->DILocations,
@@ -193,6 +194,7 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
                                       MDString *Header,
                                       ArrayRef<Metadata *> DwarfOps,
                                       StorageType Storage, bool ShouldCreate) {
+  ContextLock Lock(Context);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     GenericDINodeInfo::KeyTy Key(Tag, Header, DwarfOps);
@@ -220,6 +222,7 @@ void GenericDINode::recalculateHash() {
 #define UNWRAP_ARGS_IMPL(...) __VA_ARGS__
 #define UNWRAP_ARGS(ARGS) UNWRAP_ARGS_IMPL ARGS
 #define DEFINE_GETIMPL_LOOKUP(CLASS, ARGS)                                     \
+  ContextLock Lock(Context);                                                   \
   do {                                                                         \
     if (Storage == Uniqued) {                                                  \
       if (auto *N = getUniqued(Context.pImpl->CLASS##s,                        \
@@ -341,6 +341,7 @@ GlobalVariable::GlobalVariable(Module &M, Type *Ty, bool constant,
     Op<0>() = InitVal;
   }
 
+  ContextLock Lock(getContext());
   if (Before)
     Before->getParent()->getGlobalList().insert(Before->getIterator(), this);
   else
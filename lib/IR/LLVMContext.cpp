@@ -97,7 +97,10 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
   (void)SystemSSID;
 }
 
-LLVMContext::~LLVMContext() { delete pImpl; }
+LLVMContext::~LLVMContext() {
+  setConcurrent(false);
+  delete pImpl;
+}
 
 void LLVMContext::addModule(Module *M) {
   pImpl->OwnedModules.insert(M);
@@ -227,6 +230,8 @@ LLVMContext::getDiagnosticMessagePrefix(DiagnosticSeverity Severity) {
 }
 
 void LLVMContext::diagnose(const DiagnosticInfo &DI) {
+  // Diagnostics from concurrent passes are emitted one at a time.
+  ContextLock Lock(*this);
   if (auto *OptDiagBase = dyn_cast<DiagnosticInfoOptimizationBase>(&DI)) {
     yaml::Output *Out = getDiagnosticsOutputFile();
     if (Out) {
@@ -263,6 +268,7 @@ void LLVMContext::emitError(unsigned LocCookie, const Twine &ErrorStr) {
 
 /// Return a unique non-zero ID for the specified metadata kind.
 unsigned LLVMContext::getMDKindID(StringRef Name) const {
+  ContextLock Lock(*this);
   // If this is new, assign it its ID.
   return pImpl->CustomMDKindNames.insert(
                                      std::make_pair(
@@ -332,6 +338,18 @@ void LLVMContext::setDiscardValueNames(bool Discard) {
   pImpl->DiscardValueNames = Discard;
 }
 
+bool LLVMContext::isConcurrent() const { return pImpl->IsConcurrent; }
+
+void LLVMContext::setConcurrent(bool Concurrent) {
+  if (pImpl->IsConcurrent == Concurrent)
+    return;
+  pImpl->IsConcurrent = Concurrent;
+  if (Concurrent)
+    ++Value::NumConcurrentContexts;
+  else
+    --Value::NumConcurrentContexts;
+}
+
 OptPassGate &LLVMContext::getOptPassGate() const {
   return pImpl->getOptPassGate();
 }
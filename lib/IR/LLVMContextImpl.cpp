@@ -198,6 +198,7 @@ unsigned MDNodeOpsKey::calculateHash(ArrayRef<Metadata *> Ops) {
 }
 
 StringMapEntry<uint32_t> *LLVMContextImpl::getOrInsertBundleTag(StringRef Tag) {
+  ContextLock Lock(*this);
   uint32_t NewIdx = BundleTagCache.size();
   return &*(BundleTagCache.insert(std::make_pair(Tag, NewIdx)).first);
 }
@@ -209,12 +210,14 @@ void LLVMContextImpl::getOperandBundleTags(SmallVectorImpl<StringRef> &Tags) con
 }
 
 uint32_t LLVMContextImpl::getOperandBundleTagID(StringRef Tag) const {
+  ContextLock Lock(*this);
   auto I = BundleTagCache.find(Tag);
   assert(I != BundleTagCache.end() && "Unknown tag!");
   return I->second;
 }
 
 SyncScope::ID LLVMContextImpl::getOrInsertSyncScopeID(StringRef SSN) {
+  ContextLock Lock(*this);
   auto NewSSID = SSC.size();
   assert(NewSSID < std::numeric_limits<SyncScope::ID>::max() &&
          "Hit the maximum number of synchronization scopes allowed!");
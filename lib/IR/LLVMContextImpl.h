@@ -17,6 +17,7 @@
 
 #include "AttributeImpl.h"
 #include "ConstantsContext.h"
+#include "ContextLock.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -1376,6 +1377,12 @@ public:
   /// not.
   bool DiscardValueNames = false;
 
+  /// Flag to indicate if the state above may be accessed from several threads
+  /// at once, in which case every access holds ConcurrentMutex. See
+  /// ContextLock.
+  bool IsConcurrent = false;
+  mutable std::recursive_mutex ConcurrentMutex;
+
   LLVMContextImpl(LLVMContext &C);
   ~LLVMContextImpl();
 
@@ -1396,6 +1403,15 @@ public:
   void setOptPassGate(OptPassGate&);
 };
 
+ContextLock::ContextLock(const LLVMContextImpl &CImpl) {
+  if (LLVM_UNLIKELY(CImpl.IsConcurrent)) {
+    Mutex = &CImpl.ConcurrentMutex;
+    Mutex->lock();
+  }
+}
+
+ContextLock::ContextLock(const LLVMContext &C) : ContextLock(*C.pImpl) {}
+
 } // end namespace llvm
 
 #endif // LLVM_LIB_IR_LLVMCONTEXTIMPL_H
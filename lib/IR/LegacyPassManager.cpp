@@ -25,11 +25,16 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <chrono>
 #include <unordered_set>
 using namespace llvm;
 using namespace llvm::legacy;
@@ -559,6 +564,90 @@ public:
 
 static TimingInfo *TheTimeInfo;
 
+static cl::opt<std::string> PassTraceFile(
+    "time-passes-trace", cl::Hidden, cl::value_desc("filename"),
+    cl::desc("Record every run of a pass, with the function or module it ran "
+             "on, in a Chrome trace-event file written on exit"));
+
+namespace {
+
+/// The pass runs recorded for -time-passes-trace. The trace is written when
+/// this is destroyed, at llvm_shutdown.
+class PassTrace {
+  struct Event {
+    std::string Name;
+    std::string Target;
+    uint64_t StartMicros;
+    uint64_t DurationMicros;
+    uint64_t ThreadID;
+    unsigned SizeBefore;
+    unsigned SizeAfter;
+    int64_t MallocDelta;
+  };
+
+  sys::SmartMutex<true> EventsMutex;
+  std::vector<Event> Events;
+  std::chrono::steady_clock::time_point Epoch =
+      std::chrono::steady_clock::now();
+
+public:
+  ~PassTrace() { write(); }
+
+  static void createThePassTrace();
+
+  uint64_t nowMicros() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - Epoch)
+        .count();
+  }
+
+  void record(Pass *P, std::string Target, uint64_t StartMicros,
+              uint64_t EndMicros, unsigned SizeBefore, unsigned SizeAfter,
+              int64_t MallocDelta) {
+    StringRef Name = P->getPassName();
+    if (const PassInfo *PI = Pass::lookupPassInfo(P->getPassID()))
+      if (!PI->getPassArgument().empty())
+        Name = PI->getPassArgument();
+
+    sys::SmartScopedLock<true> Lock(EventsMutex);
+    Events.push_back({Name, std::move(Target), StartMicros,
+                      EndMicros - StartMicros, get_threadid(), SizeBefore,
+                      SizeAfter, MallocDelta});
+  }
+
+  void write() {
+    std::error_code EC;
+    raw_fd_ostream OS(PassTraceFile, EC, sys::fs::F_Text);
+    if (EC) {
+      errs() << "Could not open pass trace file '" << PassTraceFile
+             << "': " << EC.message() << '\n';
+      return;
+    }
+
+    json::Array TraceEvents;
+    for (Event &E : Events)
+      TraceEvents.push_back(json::Object{
+          {"name", std::move(E.Name)},
+          {"cat", "pass"},
+          {"ph", "X"},
+          {"pid", 1},
+          {"tid", int64_t(E.ThreadID)},
+          {"ts", int64_t(E.StartMicros)},
+          {"dur", int64_t(E.DurationMicros)},
+          {"args", json::Object{{"target", std::move(E.Target)},
+                                {"ir-size-before", E.SizeBefore},
+                                {"ir-size-after", E.SizeAfter},
+                                {"malloc-delta", E.MallocDelta}}}});
+    OS << json::Value(json::Object{{"traceEvents", std::move(TraceEvents)},
+                                   {"displayTimeUnit", "ms"}})
+       << '\n';
+  }
+};
+
+} // end anonymous namespace
+
+static PassTrace *ThePassTrace;
+
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
 
@@ -1363,6 +1452,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, BB);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassTraceRegion Trace(BP, BB);
         unsigned InstrCount = initSizeRemarkInfo(M);
         LocalChanged |= BP->runOnBasicBlock(BB);
         emitInstrCountChangedRemark(BP, M, InstrCount);
@@ -1528,6 +1618,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassTrace::createThePassTrace();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
@@ -1581,6 +1672,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassTraceRegion Trace(FP, F);
       unsigned InstrCount = initSizeRemarkInfo(M);
       LocalChanged |= FP->runOnFunction(F);
       emitInstrCountChangedRemark(FP, M, InstrCount);
@@ -1659,6 +1751,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassTraceRegion Trace(MP, M);
 
       unsigned InstrCount = initSizeRemarkInfo(M);
       LocalChanged |= MP->runOnModule(M);
@@ -1756,6 +1849,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassTrace::createThePassTrace();
 
   dumpArguments();
   dumpPasses();
@@ -1834,6 +1928,101 @@ void llvm::reportAndResetTimings() {
     TheTimeInfo->print();
 }
 
+//===----------------------------------------------------------------------===//
+// PassTraceRegion implementation
+
+// createThePassTrace - Initializes ThePassTrace if -time-passes-trace was
+// given. It may be called multiple times.
+void PassTrace::createThePassTrace() {
+  if (PassTraceFile.empty() || ThePassTrace)
+    return;
+
+  // As for TimingInfo, constructing this on first use guarantees that it is
+  // destroyed, and the trace written, before the static globals it uses.
+  static ManagedStatic<PassTrace> PT;
+  ThePassTrace = &*PT;
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, Module &M) {
+  if (ThePassTrace && !P->getAsPMDataManager()) {
+    this->M = &M;
+    Target = M.getModuleIdentifier();
+    begin(P);
+  }
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, Function &F) {
+  if (ThePassTrace && !P->getAsPMDataManager()) {
+    this->F = &F;
+    Target = F.getName();
+    begin(P);
+  }
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, BasicBlock &BB) {
+  if (ThePassTrace && !P->getAsPMDataManager()) {
+    this->BB = &BB;
+    Target = BB.getName();
+    begin(P);
+  }
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, StringRef Name,
+                                 function_ref<unsigned()> GetSize) {
+  if (ThePassTrace && !P->getAsPMDataManager()) {
+    this->GetSize = GetSize;
+    Target = Name;
+    begin(P);
+  }
+}
+
+PassTraceRegion::PassTraceRegion(Pass *P, ArrayRef<Function *> SCC) {
+  if (ThePassTrace && !P->getAsPMDataManager()) {
+    this->SCC.assign(SCC.begin(), SCC.end());
+    raw_string_ostream OS(Target);
+    for (Function *F : SCC) {
+      if (F != SCC.front())
+        OS << ',';
+      OS << F->getName();
+    }
+    OS.flush();
+    begin(P);
+  }
+}
+
+void PassTraceRegion::begin(Pass *P) {
+  this->P = P;
+  SizeBefore = getSize();
+  MallocBefore = sys::Process::GetMallocUsage();
+  StartMicros = ThePassTrace->nowMicros();
+}
+
+unsigned PassTraceRegion::getSize() const {
+  if (F)
+    return F->getInstructionCount();
+  if (BB)
+    return BB->size();
+  if (GetSize)
+    return (*GetSize)();
+  if (M)
+    return M->getInstructionCount();
+  unsigned Size = 0;
+  for (Function *F : SCC)
+    Size += F->getInstructionCount();
+  return Size;
+}
+
+PassTraceRegion::~PassTraceRegion() {
+  if (!P)
+    return;
+
+  uint64_t EndMicros = ThePassTrace->nowMicros();
+  int64_t MallocDelta =
+      int64_t(sys::Process::GetMallocUsage()) - int64_t(MallocBefore);
+  ThePassTrace->record(P, std::move(Target), StartMicros, EndMicros,
+                       SizeBefore, getSize(), MallocDelta);
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -66,6 +66,7 @@ MetadataAsValue::MetadataAsValue(Type *Ty, Metadata *MD)
 }
 
 MetadataAsValue::~MetadataAsValue() {
+  ContextLock Lock(getContext());
   getType()->getContext().pImpl->MetadataAsValues.erase(MD);
   untrack();
 }
@@ -104,6 +105,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 }
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
+  ContextLock Lock(Context);
   MD = canonicalizeMetadataForValue(Context, MD);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
@@ -113,6 +115,7 @@ MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
 
 MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
                                               Metadata *MD) {
+  ContextLock Lock(Context);
   MD = canonicalizeMetadataForValue(Context, MD);
   auto &Store = Context.pImpl->MetadataAsValues;
   return Store.lookup(MD);
@@ -120,6 +123,7 @@ MetadataAsValue *MetadataAsValue::getIfExists(LLVMContext &Context,
 
 void MetadataAsValue::handleChangedMetadata(Metadata *MD) {
   LLVMContext &Context = getContext();
+  ContextLock Lock(Context);
   MD = canonicalizeMetadataForValue(Context, MD);
   auto &Store = Context.pImpl->MetadataAsValues;
 
@@ -196,6 +200,7 @@ bool MetadataTracking::isReplaceable(const Metadata &MD) {
 }
 
 void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
+  ContextLock Lock(Context);
   bool WasInserted =
       UseMap.insert(std::make_pair(Ref, std::make_pair(Owner, NextIndex)))
           .second;
@@ -207,6 +212,7 @@ void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
 }
 
 void ReplaceableMetadataImpl::dropRef(void *Ref) {
+  ContextLock Lock(Context);
   bool WasErased = UseMap.erase(Ref);
   (void)WasErased;
   assert(WasErased && "Expected to drop a reference");
@@ -214,6 +220,7 @@ void ReplaceableMetadataImpl::dropRef(void *Ref) {
 
 void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
                                       const Metadata &MD) {
+  ContextLock Lock(Context);
   auto I = UseMap.find(Ref);
   assert(I != UseMap.end() && "Expected to move a reference");
   auto OwnerAndIndex = I->second;
@@ -231,6 +238,7 @@ void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
 }
 
 void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
+  ContextLock Lock(Context);
   if (UseMap.empty())
     return;
 
@@ -279,6 +287,7 @@ void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
 }
 
 void ReplaceableMetadataImpl::resolveAllUses(bool ResolveUsers) {
+  ContextLock Lock(Context);
   if (UseMap.empty())
     return;
 
@@ -350,6 +359,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  ContextLock Lock(Context);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -367,12 +377,14 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
+  ContextLock Lock(V->getContext());
   return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
+  ContextLock Lock(V->getContext());
   auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
@@ -396,6 +408,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  ContextLock Lock(Context);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
@@ -452,6 +465,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  ContextLock Lock(Context);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.try_emplace(Str);
   auto &MapEntry = I.first->getValue();
@@ -781,6 +795,7 @@ template <class NodeTy> struct MDNode::HasCachedHash {
 
 MDNode *MDNode::uniquify() {
   assert(!hasSelfReference(this) && "Cannot uniquify a self-referencing node");
+  ContextLock Lock(getContext());
 
   // Try to insert into uniquing store.
   switch (getMetadataID()) {
@@ -799,6 +814,7 @@ MDNode *MDNode::uniquify() {
 }
 
 void MDNode::eraseFromStore() {
+  ContextLock Lock(getContext());
   switch (getMetadataID()) {
   default:
     llvm_unreachable("Invalid or non-uniquable subclass of MDNode");
@@ -812,6 +828,7 @@ void MDNode::eraseFromStore() {
 
 MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           StorageType Storage, bool ShouldCreate) {
+  ContextLock Lock(Context);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
@@ -853,6 +870,7 @@ void MDNode::storeDistinctInContext() {
 #include "llvm/IR/Metadata.def"
   }
 
+  ContextLock Lock(getContext());
   getContext().pImpl->DistinctMDNodes.push_back(this);
 }
 
@@ -865,6 +883,7 @@ void MDNode::replaceOperandWith(unsigned I, Metadata *New) {
     return;
   }
 
+  ContextLock Lock(getContext());
   handleChangedOperand(mutable_begin() + I, New);
 }
 
@@ -1200,6 +1219,7 @@ void Instruction::dropUnknownNonDebugMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
+  ContextLock Lock(getContext());
   auto &InstructionMetadata = getContext().pImpl->InstructionMetadata;
 
   SmallSet<unsigned, 4> KnownSet;
@@ -1233,6 +1253,8 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     return;
   }
 
+  ContextLock Lock(getContext());
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     auto &Info = getContext().pImpl->InstructionMetadata[this];
@@ -1275,6 +1297,7 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
 
   if (!hasMetadataHashEntry())
     return nullptr;
+  ContextLock Lock(getContext());
   auto &Info = getContext().pImpl->InstructionMetadata[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -1293,6 +1316,7 @@ void Instruction::getAllMetadataImpl(
       return;
   }
 
+  ContextLock Lock(getContext());
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
@@ -1304,6 +1328,7 @@ void Instruction::getAllMetadataImpl(
 void Instruction::getAllMetadataOtherThanDebugLocImpl(
     SmallVectorImpl<std::pair<unsigned, MDNode *>> &Result) const {
   Result.clear();
+  ContextLock Lock(getContext());
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->InstructionMetadata.count(this) &&
          "Shouldn't have called this");
@@ -1375,14 +1400,17 @@ bool Instruction::extractProfTotalWeight(uint64_t &TotalVal) const {
 
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  ContextLock Lock(getContext());
   getContext().pImpl->InstructionMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
 
 void GlobalObject::getMetadata(unsigned KindID,
                                SmallVectorImpl<MDNode *> &MDs) const {
-  if (hasMetadata())
+  if (hasMetadata()) {
+    ContextLock Lock(getContext());
     getContext().pImpl->GlobalObjectMetadata[this].get(KindID, MDs);
+  }
 }
 
 void GlobalObject::getMetadata(StringRef Kind,
@@ -1392,6 +1420,7 @@ void GlobalObject::getMetadata(StringRef Kind,
 }
 
 void GlobalObject::addMetadata(unsigned KindID, MDNode &MD) {
+  ContextLock Lock(getContext());
   if (!hasMetadata())
     setHasMetadataHashEntry(true);
 
@@ -1407,6 +1436,7 @@ bool GlobalObject::eraseMetadata(unsigned KindID) {
   if (!hasMetadata())
     return false;
 
+  ContextLock Lock(getContext());
   auto &Store = getContext().pImpl->GlobalObjectMetadata[this];
   bool Changed = Store.erase(KindID);
   if (Store.empty())
@@ -1421,12 +1451,14 @@ void GlobalObject::getAllMetadata(
   if (!hasMetadata())
     return;
 
+  ContextLock Lock(getContext());
   getContext().pImpl->GlobalObjectMetadata[this].getAll(MDs);
 }
 
 void GlobalObject::clearMetadata() {
   if (!hasMetadata())
     return;
+  ContextLock Lock(getContext());
   getContext().pImpl->GlobalObjectMetadata.erase(this);
   setHasMetadataHashEntry(false);
 }
@@ -1442,8 +1474,10 @@ void GlobalObject::setMetadata(StringRef Kind, MDNode *N) {
 }
 
 MDNode *GlobalObject::getMetadata(unsigned KindID) const {
-  if (hasMetadata())
+  if (hasMetadata()) {
+    ContextLock Lock(getContext());
     return getContext().pImpl->GlobalObjectMetadata[this].lookup(KindID);
+  }
   return nullptr;
 }
 
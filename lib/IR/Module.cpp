@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Module.h"
+#include "LLVMContextImpl.h"
 #include "SymbolTableListTraitsImpl.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
@@ -110,6 +111,7 @@ std::unique_ptr<RandomNumberGenerator> Module::createRNG(const Pass* P) const {
 /// the specified name, of arbitrary type.  This method returns null
 /// if a global with the specified name is not found.
 GlobalValue *Module::getNamedValue(StringRef Name) const {
+  ContextLock Lock(getContext());
   return cast_or_null<GlobalValue>(getValueSymbolTable().lookup(Name));
 }
 
@@ -141,6 +143,7 @@ void Module::getOperandBundleTags(SmallVectorImpl<StringRef> &Result) const {
 //
 Constant *Module::getOrInsertFunction(StringRef Name, FunctionType *Ty,
                                       AttributeList AttributeList) {
+  ContextLock Lock(getContext());
   // See if we have a definition for the specified function already.
   GlobalValue *F = getNamedValue(Name);
   if (!F) {
@@ -200,6 +203,7 @@ GlobalVariable *Module::getGlobalVariable(StringRef Name,
 ///   3. Finally, if the existing global is the correct declaration, return the
 ///      existing global.
 Constant *Module::getOrInsertGlobal(StringRef Name, Type *Ty) {
+  ContextLock Lock(getContext());
   // See if we have a definition for the specified global already.
   GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(getNamedValue(Name));
   if (!GV) {
@@ -242,6 +246,7 @@ GlobalIFunc *Module::getNamedIFunc(StringRef Name) const {
 NamedMDNode *Module::getNamedMetadata(const Twine &Name) const {
   SmallString<256> NameData;
   StringRef NameRef = Name.toStringRef(NameData);
+  ContextLock Lock(getContext());
   return static_cast<StringMap<NamedMDNode*> *>(NamedMDSymTab)->lookup(NameRef);
 }
 
@@ -249,6 +254,7 @@ NamedMDNode *Module::getNamedMetadata(const Twine &Name) const {
 /// with the specified name. This method returns a new NamedMDNode if a
 /// NamedMDNode with the specified name is not found.
 NamedMDNode *Module::getOrInsertNamedMetadata(StringRef Name) {
+  ContextLock Lock(getContext());
   NamedMDNode *&NMD =
     (*static_cast<StringMap<NamedMDNode *> *>(NamedMDSymTab))[Name];
   if (!NMD) {
@@ -8,8 +8,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/PassManager.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include <atomic>
 
 using namespace llvm;
 
@@ -94,3 +106,242 @@ bool FunctionAnalysisManagerModuleProxy::Result::invalidate(
 AnalysisSetKey CFGAnalyses::SetKey;
 
 AnalysisSetKey PreservedAnalyses::AllAnalysesKey;
+
+/// Returns \p Base if no global in \p M is called that, and otherwise the
+/// first free "Base.N", probing from the last suffix handed out for \p Base.
+static std::string getFreeGlobalName(Module &M, StringRef Base,
+                                     StringMap<unsigned> &NextSuffix) {
+  if (!M.getNamedValue(Base))
+    return Base;
+  unsigned &Suffix = NextSuffix[Base];
+  for (;;) {
+    std::string Name = (Base + "." + Twine(++Suffix)).str();
+    if (!M.getNamedValue(Name))
+      return Name;
+  }
+}
+
+/// Numbers the instructions of \p Functions and the constants they use, in a
+/// walk that only depends on the IR: functions in the given order, their
+/// instructions in program order, operands in order, and constants depth
+/// first. The initializer of a global in \p NewGlobals is walked when the
+/// global is first reached, so globals only referenced from it are numbered
+/// right after it. Numbers start at 1. The reached constants are appended to
+/// \p Constants in the order they are numbered.
+static void numberValues(ArrayRef<Function *> Functions,
+                         const SmallPtrSetImpl<GlobalVariable *> &NewGlobals,
+                         DenseMap<const Value *, unsigned> &Numbers,
+                         std::vector<Constant *> &Constants) {
+  unsigned Next = 0;
+  SmallVector<std::pair<Constant *, unsigned>, 8> Stack;
+  auto Enter = [&](Value *V) {
+    auto *C = dyn_cast<Constant>(V);
+    if (!C || !Numbers.insert({C, Next + 1}).second)
+      return;
+    ++Next;
+    Constants.push_back(C);
+    Stack.push_back({C, 0});
+  };
+
+  for (Function *F : Functions)
+    for (Instruction &I : instructions(*F)) {
+      Numbers[&I] = ++Next;
+      for (Value *Op : I.operands()) {
+        Enter(Op);
+        while (!Stack.empty()) {
+          Constant *C = Stack.back().first;
+          unsigned OpNo = Stack.back().second++;
+          Constant *Child = nullptr;
+          if (auto *GV = dyn_cast<GlobalVariable>(C)) {
+            if (OpNo == 0 && GV->hasInitializer() && NewGlobals.count(GV))
+              Child = GV->getInitializer();
+          } else if (!isa<GlobalValue>(C) && OpNo < C->getNumOperands()) {
+            Child = cast<Constant>(C->getOperand(OpNo));
+          }
+          if (Child)
+            Enter(Child);
+          else
+            Stack.pop_back();
+        }
+      }
+    }
+}
+
+/// Threads running function pipelines concurrently may create module-level
+/// entities, such as library function declarations or private string
+/// constants, in whatever order they happen to get there, and the symbol table
+/// hands out name suffixes in that order too. Likewise, the uses they add to
+/// shared constants, globals and declarations end up in the use lists in that
+/// order. Put everything created after \p LastFunction and \p LastGlobal back
+/// in an order that only depends on \p Functions, rename the local globals to
+/// match, and sort the use lists of the constants \p Functions use.
+static void canonicalizeNewGlobals(Module &M, ArrayRef<Function *> Functions,
+                                   Function *LastFunction,
+                                   GlobalVariable *LastGlobal) {
+  auto &FunctionList = M.getFunctionList();
+  auto FI = LastFunction ? std::next(LastFunction->getIterator())
+                         : FunctionList.begin();
+  SmallVector<Function *, 8> NewFunctions;
+  for (Function &F : make_range(FI, FunctionList.end()))
+    NewFunctions.push_back(&F);
+  // Function passes can only create declarations, which keep their names.
+  std::stable_sort(NewFunctions.begin(), NewFunctions.end(),
+                   [](Function *LHS, Function *RHS) {
+                     return LHS->getName() < RHS->getName();
+                   });
+  for (Function *F : NewFunctions)
+    FunctionList.splice(FunctionList.end(), FunctionList, F->getIterator());
+
+  auto &GlobalList = M.getGlobalList();
+  auto GI = LastGlobal ? std::next(LastGlobal->getIterator())
+                       : GlobalList.begin();
+  SmallVector<GlobalVariable *, 8> NewGlobals;
+  for (GlobalVariable &GV : make_range(GI, GlobalList.end()))
+    NewGlobals.push_back(&GV);
+
+  SmallPtrSet<GlobalVariable *, 8> NewGlobalSet(NewGlobals.begin(),
+                                                NewGlobals.end());
+  DenseMap<const Value *, unsigned> Numbers;
+  std::vector<Constant *> Constants;
+  numberValues(Functions, NewGlobalSet, Numbers, Constants);
+
+  // A use is keyed by its user, then by its operand number. Users outside of
+  // Functions, such as instructions of other modules, keep their relative
+  // order in front of the others.
+  for (Constant *C : Constants)
+    if (C->hasNUsesOrMore(2))
+      C->sortUseList([&](const Use &LHS, const Use &RHS) {
+        unsigned LHSNumber = Numbers.lookup(LHS.getUser());
+        unsigned RHSNumber = Numbers.lookup(RHS.getUser());
+        if (LHSNumber != RHSNumber)
+          return LHSNumber < RHSNumber;
+        return LHS.getOperandNo() < RHS.getOperandNo();
+      });
+
+  if (NewGlobals.empty())
+    return;
+
+  // New globals go in the order they are first reached, directly or through
+  // the initializers of other new globals. Those no instruction reaches sort
+  // last, by name.
+  std::stable_sort(NewGlobals.begin(), NewGlobals.end(),
+                   [&](GlobalVariable *LHS, GlobalVariable *RHS) {
+                     unsigned LHSNumber = Numbers.lookup(LHS) - 1;
+                     unsigned RHSNumber = Numbers.lookup(RHS) - 1;
+                     if (LHSNumber != RHSNumber)
+                       return LHSNumber < RHSNumber;
+                     return LHS->getName() < RHS->getName();
+                   });
+
+  // Drop the racy suffixes from local names before handing out new ones, so
+  // that no new global keeps a name another one should get.
+  SmallVector<std::string, 8> BaseNames;
+  for (GlobalVariable *GV : NewGlobals) {
+    StringRef Name = GV->getName();
+    if (GV->hasLocalLinkage()) {
+      StringRef Base, Suffix;
+      std::tie(Base, Suffix) = Name.rsplit('.');
+      unsigned Unused;
+      if (!Suffix.empty() && !Suffix.getAsInteger(10, Unused))
+        Name = Base;
+    }
+    BaseNames.push_back(Name);
+  }
+  for (GlobalVariable *GV : NewGlobals)
+    if (GV->hasLocalLinkage())
+      GV->setName("");
+  StringMap<unsigned> NextSuffix;
+  for (size_t I = 0, E = NewGlobals.size(); I != E; ++I) {
+    GlobalVariable *GV = NewGlobals[I];
+    if (GV->hasLocalLinkage() && !BaseNames[I].empty())
+      GV->setName(getFreeGlobalName(M, BaseNames[I], NextSuffix));
+    GlobalList.splice(GlobalList.end(), GlobalList, GV->getIterator());
+  }
+}
+
+std::vector<PreservedAnalyses>
+ParallelModuleToFunctionPassAdaptor::runOnFunctions(
+    ArrayRef<Function *> Functions, const PipelineBuilderT &BuildPipeline,
+    ModuleAnalysisManager &AM, unsigned ThreadCount, bool DebugLogging) {
+  std::vector<PreservedAnalyses> Results(Functions.size());
+  if (Functions.empty())
+    return Results;
+  Module &M = *Functions.front()->getParent();
+
+  unsigned Threads =
+      ThreadCount ? ThreadCount : heavyweight_hardware_concurrency();
+  Threads = std::max(1u, std::min<unsigned>(Threads, Functions.size()));
+
+  std::atomic<size_t> NextIndex(0);
+
+  // Each worker owns its pipeline and its analysis caches, and claims
+  // functions one at a time so that long functions don't unbalance the load.
+  auto RunWorker = [&]() {
+    std::shared_ptr<void> PipelineState;
+    FunctionPassManager FPM(DebugLogging);
+    FunctionAnalysisManager FAM(DebugLogging);
+    PipelineState = BuildPipeline(FPM, FAM);
+    FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(AM); });
+
+    for (size_t I = NextIndex++; I < Functions.size(); I = NextIndex++) {
+      Function &F = *Functions[I];
+      Results[I] = FPM.run(F, FAM);
+      // The worker's cache is only useful for the function at hand; drop it
+      // so that memory stays bounded by the number of threads.
+      FAM.clear(F, F.getName());
+    }
+  };
+
+  Function *LastFunction = M.empty() ? nullptr : &M.getFunctionList().back();
+  GlobalVariable *LastGlobal =
+      M.global_empty() ? nullptr : &M.getGlobalList().back();
+
+  LLVMContext &Ctx = M.getContext();
+  bool WasConcurrent = Ctx.isConcurrent();
+  Ctx.setConcurrent(true);
+  if (Threads == 1) {
+    RunWorker();
+  } else {
+    ThreadPool Pool(Threads);
+    for (unsigned I = 0; I != Threads; ++I)
+      Pool.async(RunWorker);
+    Pool.wait();
+  }
+  Ctx.setConcurrent(WasConcurrent);
+
+  canonicalizeNewGlobals(M, Functions, LastFunction, LastGlobal);
+  return Results;
+}
+
+PreservedAnalyses
+ParallelModuleToFunctionPassAdaptor::run(Module &M, ModuleAnalysisManager &AM) {
+  // Snapshot the work list: function passes may not add or remove functions,
+  // but they may create declarations, which would race with the iteration.
+  std::vector<Function *> Worklist;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Worklist.push_back(&F);
+  if (Worklist.empty())
+    return PreservedAnalyses::all();
+
+  std::vector<PreservedAnalyses> Results = runOnFunctions(
+      Worklist, BuildPipeline, AM, ThreadCount, DebugLogging);
+
+  // Analyses cached for these functions in the module-level function analysis
+  // manager were computed before the pipeline ran. The workers' pass managers
+  // report all function analyses as preserved once they have invalidated their
+  // own caches, so that set says nothing about ours: drop everything cached
+  // for a function unless its pipeline preserved all analyses.
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  PreservedAnalyses PA = PreservedAnalyses::all();
+  for (size_t I = 0, E = Worklist.size(); I != E; ++I) {
+    if (!Results[I].areAllPreserved())
+      FAM.clear(*Worklist[I], Worklist[I]->getName());
+    PA.intersect(std::move(Results[I]));
+  }
+
+  PA.preserveSet<AllAnalysesOn<Function>>();
+  PA.preserve<FunctionAnalysisManagerModuleProxy>();
+  return PA;
+}
@@ -253,6 +253,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
 
+  ContextLock Lock(C);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
 
   if (!Entry)
@@ -297,6 +298,7 @@ FunctionType::FunctionType(Type *Result, ArrayRef<Type*> Params,
 FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
   auto I = pImpl->FunctionTypes.find_as(Key);
   FunctionType *FT;
@@ -336,6 +338,7 @@ bool FunctionType::isValidArgumentType(Type *ArgTy) {
 StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLock Lock(*pImpl);
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
   auto I = pImpl->AnonStructTypes.find_as(Key);
   StructType *ST;
@@ -367,10 +370,12 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     return;
   }
 
+  ContextLock Lock(getContext());
   ContainedTys = Elements.copy(getContext().pImpl->TypeAllocator).data();
 }
 
 void StructType::setName(StringRef Name) {
+  ContextLock Lock(getContext());
   if (Name == getName()) return;
 
   StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
@@ -422,6 +427,7 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  ContextLock Lock(Context);
   StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -507,6 +513,7 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 }
 
 StructType *Module::getTypeByName(StringRef Name) const {
+  ContextLock Lock(getContext());
   return getContext().pImpl->NamedStructTypes.lookup(Name);
 }
 
@@ -569,6 +576,7 @@ ArrayType *ArrayType::get(Type *ElementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   ArrayType *&Entry =
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
 
@@ -597,6 +605,7 @@ VectorType *VectorType::get(Type *ElementType, unsigned NumElements) {
                                             "pointer type.");
 
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   VectorType *&Entry = ElementType->getContext().pImpl
     ->VectorTypes[std::make_pair(ElementType, NumElements)];
 
@@ -619,6 +628,7 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
 
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
+  ContextLock Lock(*CImpl);
 
   // Since AddressSpace #0 is the common case, we special case it.
   PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
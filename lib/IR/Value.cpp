@@ -193,10 +193,23 @@ static bool getSymTab(Value *V, ValueSymbolTable *&ST) {
   return false;
 }
 
+std::atomic<unsigned> Value::NumConcurrentContexts(0);
+
+void Value::addSharedUse(Use &U) {
+  ContextLock Lock(getContext());
+  U.addToList(&UseList);
+}
+
+void Value::removeSharedUse(Use &U) {
+  ContextLock Lock(getContext());
+  U.removeFromList();
+}
+
 ValueName *Value::getValueName() const {
   if (!HasName) return nullptr;
 
   LLVMContext &Ctx = getContext();
+  ContextLock Lock(Ctx);
   auto I = Ctx.pImpl->ValueNames.find(this);
   assert(I != Ctx.pImpl->ValueNames.end() &&
          "No name entry found!");
@@ -206,6 +219,7 @@ ValueName *Value::getValueName() const {
 
 void Value::setValueName(ValueName *VN) {
   LLVMContext &Ctx = getContext();
+  ContextLock Lock(Ctx);
 
   assert(HasName == Ctx.pImpl->ValueNames.count(this) &&
          "HasName bit out of sync!");
@@ -239,6 +253,9 @@ void Value::setNameImpl(const Twine &NewName) {
   if (NewName.isTriviallyEmpty() && !hasName())
     return;
 
+  // The symbol table of a module is shared by all of its functions.
+  ContextLock Lock(getContext());
+
   SmallString<256> NameData;
   StringRef NameRef = NewName.toStringRef(NameData);
   assert(NameRef.find_first_of(0) == StringRef::npos &&
@@ -299,6 +316,7 @@ void Value::setName(const Twine &NewName) {
 }
 
 void Value::takeName(Value *V) {
+  ContextLock Lock(getContext());
   ValueSymbolTable *ST = nullptr;
   // If this value has a name, drop it.
   if (hasName()) {
@@ -748,6 +766,8 @@ bool Value::isSwiftError() const {
 
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
+  // The head of the list may live in the ValueHandles map of the context.
+  ContextLock Lock(getValPtr()->getContext());
 
   // Splice ourselves into the list.
   Next = *List;
@@ -773,6 +793,7 @@ void ValueHandleBase::AddToUseList() {
   assert(getValPtr() && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = getValPtr()->getContext().pImpl;
+  ContextLock Lock(*pImpl);
 
   if (getValPtr()->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -815,6 +836,7 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(getValPtr() && getValPtr()->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  ContextLock Lock(getValPtr()->getContext());
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -844,6 +866,7 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[V];
   assert(Entry && "Value bit set but no entries exist");
 
@@ -900,6 +923,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
+  ContextLock Lock(*pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[Old];
 
   assert(Entry && "Value bit set but no entries exist");
@@ -13,12 +13,19 @@
 
 #include "llvm/LTO/Caching.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/LockFileManager.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <chrono>
+#include <mutex>
+#include <set>
+
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
 #else
@@ -28,43 +35,383 @@
 using namespace llvm;
 using namespace llvm::lto;
 
-Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
-                                            AddBufferFn AddBuffer) {
-  if (std::error_code EC = sys::fs::create_directories(CacheDirectoryPath))
-    return errorCodeToError(EC);
+static void getEntryPath(StringRef CacheDirectoryPath, StringRef Key,
+                         SmallVectorImpl<char> &EntryPath) {
+  sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
+}
+
+namespace {
+/// The index of a cache directory created by localIndexedCache(). It maps the
+/// key of each entry to its size and last use, so that lookups of unknown keys
+/// and size-based eviction do not need to access the file system.
+///
+/// The index is loaded from the file "llvmcache.index" in the cache directory
+/// when the cache is created. Only if that file is missing or corrupt is it
+/// rebuilt from a listing of the directory. Every InsertsPerPersist
+/// insertions, and when the last user of the cache is destroyed, the index is
+/// merged with the updates made by other processes and atomically replaced on
+/// disk under a lock file. Lookups and insertions made meanwhile only wait for
+/// the in-memory part of the merge.
+class CacheIndex {
+public:
+  CacheIndex(StringRef CacheDirectoryPath, uint64_t MaxSizeBytes);
+  ~CacheIndex();
+
+  /// Returns true and records a use if there is an entry for \p Key.
+  bool lookup(StringRef Key);
+
+  /// Records a new entry of \p Size bytes for \p Key, then evicts the least
+  /// recently used entries until the cache fits within its size limit.
+  void insert(StringRef Key, uint64_t Size);
+
+  /// Forgets the entry for \p Key, whose file has been removed.
+  void erase(StringRef Key);
+
+private:
+  struct Entry {
+    uint64_t Size;
+    uint64_t LastUse;
+  };
+
+  static const unsigned InsertsPerPersist = 64;
+
+  static uint64_t now();
+
+  // These expect Mutex to be held, or the index not to be shared yet.
+  void addEntry(StringRef Key, Entry E);
+  void touchEntry(StringMapIterator<Entry> I, uint64_t LastUse);
+  void eraseEntry(StringRef Key);
+  void evict(std::vector<std::string> &Evicted);
+  std::string serialize() const;
+
+  void persist();
+  void removeFiles(ArrayRef<std::string> Keys) const;
+  bool readIndexFile(StringMap<Entry> &Result) const;
+  void scanDirectory();
+  bool writeIndexFile(StringRef Contents) const;
+
+  std::string CacheDirectoryPath;
+  std::string IndexPath;
+  uint64_t MaxSizeBytes;
+
+  /// Serializes the threads of this process that write the index.
+  std::mutex PersistMutex;
+
+  std::mutex Mutex;
+  StringMap<Entry> Entries;
+  /// The entries ordered by (last use, key), least recently used first.
+  std::set<std::pair<uint64_t, std::string>> ByLastUse;
+  uint64_t TotalSize = 0;
+  unsigned InsertsSincePersist = 0;
+  /// Keys removed by this process since the index was last written, which
+  /// must not be brought back when merging with the index on disk unless
+  /// another process has committed them again.
+  StringSet<> Erased;
+};
+} // end anonymous namespace
+
+static const char IndexMagic[] = "llvmcache-index-v1";
+
+CacheIndex::CacheIndex(StringRef CacheDirectoryPath, uint64_t MaxSizeBytes)
+    : CacheDirectoryPath(CacheDirectoryPath), MaxSizeBytes(MaxSizeBytes) {
+  SmallString<64> Path;
+  sys::path::append(Path, CacheDirectoryPath, "llvmcache.index");
+  IndexPath = Path.str();
+
+  StringMap<Entry> OnDisk;
+  if (readIndexFile(OnDisk)) {
+    for (auto &E : OnDisk)
+      addEntry(E.first(), E.second);
+    return;
+  }
+  scanDirectory();
+  persist();
+}
 
+CacheIndex::~CacheIndex() {
+  // Record the insertions and uses since the index was last written.
+  persist();
+}
+
+uint64_t CacheIndex::now() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(system_clock::now().time_since_epoch())
+      .count();
+}
+
+bool CacheIndex::lookup(StringRef Key) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto I = Entries.find(Key);
+  if (I == Entries.end())
+    return false;
+  touchEntry(I, now());
+  return true;
+}
+
+void CacheIndex::insert(StringRef Key, uint64_t Size) {
+  std::vector<std::string> Evicted;
+  bool ShouldPersist;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    eraseEntry(Key);
+    Erased.erase(Key);
+    addEntry(Key, {Size, now()});
+    evict(Evicted);
+    ShouldPersist = ++InsertsSincePersist >= InsertsPerPersist;
+  }
+  removeFiles(Evicted);
+  if (ShouldPersist)
+    persist();
+}
+
+void CacheIndex::erase(StringRef Key) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  eraseEntry(Key);
+  Erased.insert(Key);
+}
+
+void CacheIndex::addEntry(StringRef Key, Entry E) {
+  if (!Entries.insert({Key, E}).second)
+    return;
+  ByLastUse.insert({E.LastUse, Key});
+  TotalSize += E.Size;
+}
+
+void CacheIndex::touchEntry(StringMapIterator<Entry> I, uint64_t LastUse) {
+  if (LastUse <= I->second.LastUse)
+    return;
+  ByLastUse.erase({I->second.LastUse, I->first()});
+  I->second.LastUse = LastUse;
+  ByLastUse.insert({LastUse, I->first()});
+}
+
+void CacheIndex::eraseEntry(StringRef Key) {
+  auto I = Entries.find(Key);
+  if (I == Entries.end())
+    return;
+  ByLastUse.erase({I->second.LastUse, Key});
+  TotalSize -= I->second.Size;
+  Entries.erase(I);
+}
+
+/// Drops the least recently used entries until the cache fits within its
+/// size limit. Their files are left for the caller to remove, so that this
+/// does not access the file system.
+void CacheIndex::evict(std::vector<std::string> &Evicted) {
+  if (!MaxSizeBytes)
+    return;
+  while (TotalSize > MaxSizeBytes && !ByLastUse.empty()) {
+    std::string Key = ByLastUse.begin()->second;
+    eraseEntry(Key);
+    Erased.insert(Key);
+    Evicted.push_back(std::move(Key));
+  }
+}
+
+std::string CacheIndex::serialize() const {
+  std::string Contents;
+  raw_string_ostream OS(Contents);
+  OS << IndexMagic << '\n';
+  for (auto &E : Entries)
+    OS << E.first() << ' ' << E.second.Size << ' ' << E.second.LastUse << '\n';
+  return OS.str();
+}
+
+/// Merges the index on disk into this one, evicts entries over the size limit
+/// and writes the result back.
+void CacheIndex::persist() {
+  std::lock_guard<std::mutex> PersistLock(PersistMutex);
+
+  // Serialize with other processes updating the same index so that none of
+  // their updates get lost. If the lock cannot be used, merge and write
+  // anyway: the index is replaced atomically, so the worst case is that
+  // another process's concurrent update is dropped.
+  while (true) {
+    LockFileManager FileLock(IndexPath);
+    if (FileLock.getState() == LockFileManager::LFS_Shared) {
+      if (FileLock.waitForUnlock() == LockFileManager::Res_Timeout)
+        FileLock.unsafeRemoveLockFile();
+      continue;
+    }
+
+    StringMap<Entry> OnDisk;
+    readIndexFile(OnDisk);
+
+    // A key removed here may have been committed again by another process
+    // since; only its file tells which. Look before taking Mutex.
+    std::vector<std::string> ErasedOnDisk;
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      for (auto &E : OnDisk)
+        if (Erased.count(E.first()))
+          ErasedOnDisk.push_back(E.first());
+    }
+    for (const std::string &Key : ErasedOnDisk) {
+      SmallString<64> EntryPath;
+      getEntryPath(CacheDirectoryPath, Key, EntryPath);
+      if (!sys::fs::exists(EntryPath))
+        OnDisk.erase(Key);
+    }
+
+    std::vector<std::string> Evicted;
+    std::string Contents;
+    StringSet<> Written;
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      for (auto &E : OnDisk) {
+        auto I = Entries.find(E.first());
+        if (I != Entries.end())
+          touchEntry(I, E.second.LastUse);
+        else
+          addEntry(E.first(), E.second);
+      }
+      evict(Evicted);
+      Contents = serialize();
+      InsertsSincePersist = 0;
+      std::swap(Written, Erased);
+    }
+
+    removeFiles(Evicted);
+    if (!writeIndexFile(Contents)) {
+      // Keep remembering what was removed until a write succeeds.
+      std::lock_guard<std::mutex> Lock(Mutex);
+      for (auto &Key : Written)
+        if (!Entries.count(Key.first()))
+          Erased.insert(Key.first());
+    }
+    return;
+  }
+}
+
+void CacheIndex::removeFiles(ArrayRef<std::string> Keys) const {
+  for (const std::string &Key : Keys) {
+    SmallString<64> EntryPath;
+    getEntryPath(CacheDirectoryPath, Key, EntryPath);
+    sys::fs::remove(EntryPath);
+  }
+}
+
+bool CacheIndex::readIndexFile(StringMap<Entry> &Result) const {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(IndexPath);
+  if (!MBOrErr)
+    return false;
+
+  SmallVector<StringRef, 0> Lines;
+  (*MBOrErr)->getBuffer().split(Lines, '\n', /*MaxSplit*/ -1,
+                                /*KeepEmpty*/ false);
+  if (Lines.empty() || Lines[0] != IndexMagic)
+    return false;
+
+  // Each entry is a line "<key> <size> <last use>". Ignore malformed lines
+  // rather than failing: their files get no index entry and are never
+  // returned as hits.
+  for (StringRef Line : makeArrayRef(Lines).drop_front()) {
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ');
+    Entry E;
+    if (Fields.size() != 3 || Fields[1].getAsInteger(10, E.Size) ||
+        Fields[2].getAsInteger(10, E.LastUse))
+      continue;
+    Result[Fields[0]] = E;
+  }
+  return true;
+}
+
+/// Rebuilds the index from the files in the cache directory, using their
+/// access times as last uses.
+void CacheIndex::scanDirectory() {
+  using namespace std::chrono;
+
+  std::error_code EC;
+  for (sys::fs::directory_iterator File(CacheDirectoryPath, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    StringRef Name = sys::path::filename(File->path());
+    if (!Name.startswith("llvmcache-"))
+      continue;
+    ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
+    if (!StatusOrErr)
+      continue;
+    uint64_t LastUse =
+        duration_cast<microseconds>(
+            StatusOrErr->getLastAccessedTime().time_since_epoch())
+            .count();
+    addEntry(Name.drop_front(strlen("llvmcache-")),
+             {StatusOrErr->getSize(), LastUse});
+  }
+}
+
+bool CacheIndex::writeIndexFile(StringRef Contents) const {
+  SmallString<64> TempFilenameModel;
+  sys::path::append(TempFilenameModel, CacheDirectoryPath,
+                    "llvmcache.index-%%%%%%.tmp");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+      TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return false;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /* ShouldClose */ false);
+    OS << Contents;
+  }
+
+  // On POSIX systems this atomically replaces the previous index, so readers
+  // never see a partially written file.
+  if (Error E = Temp->keep(IndexPath)) {
+    consumeError(std::move(E));
+    consumeError(Temp->discard());
+    return false;
+  }
+  return true;
+}
+
+static NativeObjectCache createLocalCache(StringRef CacheDirectoryPath,
+                                          AddBufferFn AddBuffer,
+                                          std::shared_ptr<CacheIndex> Index) {
   return [=](unsigned Task, StringRef Key) -> AddStreamFn {
     // This choice of file name allows the cache to be pruned (see pruneCache()
     // in include/llvm/Support/CachePruning.h).
     SmallString<64> EntryPath;
-    sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
-    // First, see if we have a cache hit.
-    int FD;
-    SmallString<64> ResultPath;
-    std::error_code EC = sys::fs::openFileForRead(
-        Twine(EntryPath), FD, sys::fs::OF_UpdateAtime, &ResultPath);
-    if (!EC) {
-      ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
-          MemoryBuffer::getOpenFile(FD, EntryPath,
-                                    /*FileSize*/ -1,
-                                    /*RequiresNullTerminator*/ false);
-      close(FD);
-      if (MBOrErr) {
-        AddBuffer(Task, std::move(*MBOrErr));
-        return AddStreamFn();
+    getEntryPath(CacheDirectoryPath, Key, EntryPath);
+    // First, see if we have a cache hit. An indexed cache answers lookups of
+    // keys it does not know without touching the file system, and tracks uses
+    // itself instead of through the access time.
+    if (!Index || Index->lookup(Key)) {
+      int FD;
+      SmallString<64> ResultPath;
+      std::error_code EC = sys::fs::openFileForRead(
+          Twine(EntryPath), FD,
+          Index ? sys::fs::OF_None : sys::fs::OF_UpdateAtime, &ResultPath);
+      if (!EC) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+            MemoryBuffer::getOpenFile(FD, EntryPath,
+                                      /*FileSize*/ -1,
+                                      /*RequiresNullTerminator*/ false);
+        close(FD);
+        if (MBOrErr) {
+          AddBuffer(Task, std::move(*MBOrErr));
+          return AddStreamFn();
+        }
+        EC = MBOrErr.getError();
       }
-      EC = MBOrErr.getError();
-    }
 
-    // On Windows we can fail to open a cache file with a permission denied
-    // error. This generally means that another process has requested to delete
-    // the file while it is still open, but it could also mean that another
-    // process has opened the file without the sharing permissions we need.
-    // Since the file is probably being deleted we handle it in the same way as
-    // if the file did not exist at all.
-    if (EC != errc::no_such_file_or_directory && EC != errc::permission_denied)
-      report_fatal_error(Twine("Failed to open cache file ") + EntryPath +
-                         ": " + EC.message() + "\n");
+      // On Windows we can fail to open a cache file with a permission denied
+      // error. This generally means that another process has requested to
+      // delete the file while it is still open, but it could also mean that
+      // another process has opened the file without the sharing permissions we
+      // need. Since the file is probably being deleted we handle it in the same
+      // way as if the file did not exist at all.
+      if (EC != errc::no_such_file_or_directory &&
+          EC != errc::permission_denied)
+        report_fatal_error(Twine("Failed to open cache file ") + EntryPath +
+                           ": " + EC.message() + "\n");
+
+      // The entry was pruned or evicted by another process.
+      if (Index)
+        Index->erase(Key);
+    }
 
     // This native object stream is responsible for commiting the resulting
     // file to the cache and calling AddBuffer to add it to the link.
@@ -72,14 +419,17 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
       AddBufferFn AddBuffer;
       sys::fs::TempFile TempFile;
       std::string EntryPath;
+      std::string Key;
+      std::shared_ptr<CacheIndex> Index;
       unsigned Task;
 
       CacheStream(std::unique_ptr<raw_pwrite_stream> OS, AddBufferFn AddBuffer,
                   sys::fs::TempFile TempFile, std::string EntryPath,
+                  std::string Key, std::shared_ptr<CacheIndex> Index,
                   unsigned Task)
           : NativeObjectStream(std::move(OS)), AddBuffer(std::move(AddBuffer)),
             TempFile(std::move(TempFile)), EntryPath(std::move(EntryPath)),
-            Task(Task) {}
+            Key(std::move(Key)), Index(std::move(Index)), Task(Task) {}
 
       ~CacheStream() {
         // Make sure the stream is closed before committing it.
@@ -125,6 +475,8 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
                              TempFile.TmpName + " to " + EntryPath + ": " +
                              toString(std::move(E)) + "\n");
 
+        if (Index)
+          Index->insert(Key, (*MBOrErr)->getBufferSize());
         AddBuffer(Task, std::move(*MBOrErr));
       }
     };
@@ -143,7 +495,27 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
       // This CacheStream will move the temporary file into the cache when done.
       return llvm::make_unique<CacheStream>(
           llvm::make_unique<raw_fd_ostream>(Temp->FD, /* ShouldClose */ false),
-          AddBuffer, std::move(*Temp), EntryPath.str(), Task);
+          AddBuffer, std::move(*Temp), EntryPath.str(), Key.str(), Index,
+          Task);
     };
   };
 }
+
+Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
+                                            AddBufferFn AddBuffer) {
+  if (std::error_code EC = sys::fs::create_directories(CacheDirectoryPath))
+    return errorCodeToError(EC);
+
+  return createLocalCache(CacheDirectoryPath, std::move(AddBuffer), nullptr);
+}
+
+Expected<NativeObjectCache>
+lto::localIndexedCache(StringRef CacheDirectoryPath, AddBufferFn AddBuffer,
+                       uint64_t MaxSizeBytes) {
+  if (std::error_code EC = sys::fs::create_directories(CacheDirectoryPath))
+    return errorCodeToError(EC);
+
+  return createLocalCache(
+      CacheDirectoryPath, std::move(AddBuffer),
+      std::make_shared<CacheIndex>(CacheDirectoryPath, MaxSizeBytes));
+}
@@ -27,15 +27,18 @@
 #include "llvm/LTO/LTOBackend.h"
 #include "llvm/Linker/IRMover.h"
 #include "llvm/Object/IRObjectFile.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/VCSRevision.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
@@ -44,6 +47,7 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
+#include <numeric>
 #include <set>
 
 using namespace llvm;
@@ -56,6 +60,16 @@ static cl::opt<bool>
     DumpThinCGSCCs("dump-thin-cg-sccs", cl::init(false), cl::Hidden,
                    cl::desc("Dump the SCCs in the ThinLTO index's callgraph"));
 
+static cl::opt<bool> ThinLTOScheduleByCost(
+    "thinlto-schedule-by-cost", cl::init(false), cl::Hidden,
+    cl::desc("Start the in-process ThinLTO backend jobs with the highest "
+             "estimated cost first instead of in input order"));
+
+static cl::opt<bool> ThinLTOTimeBackends(
+    "thinlto-time-backends", cl::init(false), cl::Hidden,
+    cl::desc("Report the wall time and estimated cost of each in-process "
+             "ThinLTO backend job"));
+
 // The values are (type identifier, summary) pairs.
 typedef DenseMap<
     GlobalValue::GUID,
@@ -390,6 +404,36 @@ Expected<std::unique_ptr<InputFile>> InputFile::create(MemoryBufferRef Object) {
   return std::move(File);
 }
 
+Expected<std::vector<std::unique_ptr<InputFile>>>
+InputFile::create(ArrayRef<MemoryBufferRef> Objects) {
+  std::vector<std::unique_ptr<InputFile>> Files(Objects.size());
+
+  // Only the error for the first object that fails is reported, so that the
+  // diagnostic does not depend on the order in which the objects are read.
+  std::mutex ErrMu;
+  size_t ErrIndex = Objects.size();
+  Error Err = Error::success();
+  parallel::for_each_n(parallel::par, size_t(0), Objects.size(), [&](size_t I) {
+    Expected<std::unique_ptr<InputFile>> FileOrErr = create(Objects[I]);
+    if (FileOrErr) {
+      Files[I] = std::move(*FileOrErr);
+      return;
+    }
+    std::lock_guard<std::mutex> Lock(ErrMu);
+    if (I < ErrIndex) {
+      consumeError(std::move(Err));
+      Err = FileOrErr.takeError();
+      ErrIndex = I;
+    } else {
+      consumeError(FileOrErr.takeError());
+    }
+  });
+
+  if (Err)
+    return std::move(Err);
+  return std::move(Files);
+}
+
 StringRef InputFile::getName() const {
   return Mods[0].getModuleIdentifier();
 }
@@ -491,6 +535,8 @@ static void writeToResolutionFile(raw_ostream &OS, InputFile *Input,
 Error LTO::add(std::unique_ptr<InputFile> Input,
                ArrayRef<SymbolResolution> Res) {
   assert(!CalledGetMaxTasks);
+  NamedRegionTimer T("add", "Add Input Files", "lto", "LTO",
+                     TimePassesIsEnabled);
 
   if (Conf.ResolutionFile)
     writeToResolutionFile(*Conf.ResolutionFile, Input.get(), Res);
@@ -507,20 +553,87 @@ Error LTO::add(std::unique_ptr<InputFile> Input,
   return Error::success();
 }
 
+Error LTO::add(std::vector<std::unique_ptr<InputFile>> Inputs,
+               ArrayRef<std::vector<SymbolResolution>> Res) {
+  assert(!CalledGetMaxTasks);
+  assert(Inputs.size() == Res.size());
+  NamedRegionTimer T("add", "Add Input Files", "lto", "LTO",
+                     TimePassesIsEnabled);
+
+  // Reading the LTO info requires a scan of the module's bitcode, which is
+  // independent for each module, so do it for all modules up front.
+  std::vector<std::pair<InputFile *, unsigned>> Mods;
+  for (auto &Input : Inputs)
+    for (unsigned I = 0; I != Input->Mods.size(); ++I)
+      Mods.push_back({Input.get(), I});
+
+  std::vector<BitcodeLTOInfo> LTOInfos(Mods.size());
+  std::mutex ErrMu;
+  size_t ErrIndex = Mods.size();
+  Error Err = Error::success();
+  parallel::for_each_n(parallel::par, size_t(0), Mods.size(), [&](size_t I) {
+    Expected<BitcodeLTOInfo> LTOInfo =
+        Mods[I].first->Mods[Mods[I].second].getLTOInfo();
+    if (LTOInfo) {
+      LTOInfos[I] = *LTOInfo;
+      return;
+    }
+    std::lock_guard<std::mutex> Lock(ErrMu);
+    if (I < ErrIndex) {
+      consumeError(std::move(Err));
+      Err = LTOInfo.takeError();
+      ErrIndex = I;
+    } else {
+      consumeError(LTOInfo.takeError());
+    }
+  });
+
+  // Modules are added in input order up to the first one that failed, which
+  // is what adding the inputs one by one would have done.
+  const BitcodeLTOInfo *LTOInfoI = LTOInfos.data();
+  const BitcodeLTOInfo *LTOInfoE = LTOInfoI + ErrIndex;
+  for (size_t I = 0; I != Inputs.size(); ++I) {
+    InputFile &Input = *Inputs[I];
+    if (Conf.ResolutionFile)
+      writeToResolutionFile(*Conf.ResolutionFile, &Input, Res[I]);
+
+    if (RegularLTO.CombinedModule->getTargetTriple().empty())
+      RegularLTO.CombinedModule->setTargetTriple(Input.getTargetTriple());
+
+    const SymbolResolution *ResI = Res[I].data();
+    const SymbolResolution *ResE = ResI + Res[I].size();
+    for (unsigned ModI = 0; ModI != Input.Mods.size(); ++ModI) {
+      if (LTOInfoI == LTOInfoE)
+        return Err;
+      if (Error E = addModule(Input, ModI, *LTOInfoI++, ResI, ResE)) {
+        consumeError(std::move(Err));
+        return E;
+      }
+    }
+    assert(ResI == ResE);
+  }
+  return Err;
+}
+
 Error LTO::addModule(InputFile &Input, unsigned ModI,
                      const SymbolResolution *&ResI,
                      const SymbolResolution *ResE) {
   Expected<BitcodeLTOInfo> LTOInfo = Input.Mods[ModI].getLTOInfo();
   if (!LTOInfo)
     return LTOInfo.takeError();
+  return addModule(Input, ModI, *LTOInfo, ResI, ResE);
+}
 
+Error LTO::addModule(InputFile &Input, unsigned ModI, BitcodeLTOInfo LTOInfo,
+                     const SymbolResolution *&ResI,
+                     const SymbolResolution *ResE) {
   BitcodeModule BM = Input.Mods[ModI];
   auto ModSyms = Input.module_symbols(ModI);
   addModuleToGlobalRes(ModSyms, {ResI, ResE},
-                       LTOInfo->IsThinLTO ? ThinLTO.ModuleMap.size() + 1 : 0,
-                       LTOInfo->HasSummary);
+                       LTOInfo.IsThinLTO ? ThinLTO.ModuleMap.size() + 1 : 0,
+                       LTOInfo.HasSummary);
 
-  if (LTOInfo->IsThinLTO)
+  if (LTOInfo.IsThinLTO)
     return addThinLTO(BM, ModSyms, ResI, ResE);
 
   Expected<RegularLTOState::AddedModule> ModOrErr =
@@ -528,7 +641,7 @@ Error LTO::addModule(InputFile &Input, unsigned ModI,
   if (!ModOrErr)
     return ModOrErr.takeError();
 
-  if (!LTOInfo->HasSummary)
+  if (!LTOInfo.HasSummary)
     return linkRegularLTO(std::move(*ModOrErr), /*LivenessFromIndex=*/false);
 
   // Regular LTO module summaries are added to a dummy module that represents
@@ -816,6 +929,11 @@ Error LTO::run(AddStreamFn AddStream, NativeObjectCache Cache) {
 }
 
 Error LTO::runRegularLTO(AddStreamFn AddStream) {
+  std::vector<Module *> ToPrepare;
+  for (auto &M : RegularLTO.ModsWithSummaries)
+    ToPrepare.push_back(M.M.get());
+  RegularLTO.Mover->prepare(ToPrepare);
+
   for (auto &M : RegularLTO.ModsWithSummaries)
     if (Error Err = linkRegularLTO(std::move(M),
                                    /*LivenessFromIndex=*/true))
@@ -881,6 +999,21 @@ Error LTO::runRegularLTO(AddStreamFn AddStream) {
                  std::move(RegularLTO.CombinedModule), ThinLTO.CombinedIndex);
 }
 
+/// Estimates the cost of the ThinLTO backend job for a module as the number of
+/// instructions in the functions it defines plus the number of functions it
+/// imports.
+static uint64_t
+estimateThinBackendCost(const GVSummaryMapTy &DefinedGlobals,
+                        const FunctionImporter::ImportMapTy &ImportList) {
+  uint64_t Cost = 0;
+  for (auto &Def : DefinedGlobals)
+    if (auto *FS = dyn_cast<FunctionSummary>(Def.second))
+      Cost += FS->instCount();
+  for (auto &FromModule : ImportList)
+    Cost += FromModule.second.size();
+  return Cost;
+}
+
 /// This class defines the interface to the ThinLTO backend.
 class lto::ThinBackendProc {
 protected:
@@ -902,11 +1035,22 @@ public:
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
       MapVector<StringRef, BitcodeModule> &ModuleMap) = 0;
   virtual Error wait() = 0;
+  /// Whether the backend jobs may be started in a different order than the
+  /// input order without changing the outputs of the backend.
+  virtual bool canReorderJobs() const { return false; }
 };
 
 namespace {
 class InProcessThinBackend : public ThinBackendProc {
+  /// Per-job wall times for -thinlto-time-backends, reported when the group is
+  /// destroyed. These must outlive the jobs below.
+  std::unique_ptr<TimerGroup> BackendTimerGroup;
+  std::vector<std::unique_ptr<Timer>> BackendTimers;
+
   ThreadPool BackendThreadPool;
+  /// The backend jobs. Once one of them fails the link fails as well, so the
+  /// group is cancelled to skip the jobs that have not started yet.
+  ThreadPoolTaskGroup Backends;
   AddStreamFn AddStream;
   NativeObjectCache Cache;
   TypeIdSummariesByGuidTy TypeIdSummariesByGuid;
@@ -923,7 +1067,7 @@ public:
       const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
       AddStreamFn AddStream, NativeObjectCache Cache)
       : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries),
-        BackendThreadPool(ThinLTOParallelismLevel),
+        BackendThreadPool(ThinLTOParallelismLevel), Backends(BackendThreadPool),
         AddStream(std::move(AddStream)), Cache(std::move(Cache)) {
     // Create a mapping from type identifier GUIDs to type identifier summaries.
     // This allows backends to use the type identifier GUIDs stored in the
@@ -937,6 +1081,9 @@ public:
     for (auto &Name : CombinedIndex.cfiFunctionDecls())
       CfiFunctionDecls.insert(
           GlobalValue::getGUID(GlobalValue::dropLLVMManglingEscape(Name)));
+    if (ThinLTOTimeBackends)
+      BackendTimerGroup = llvm::make_unique<TimerGroup>(
+          "thinlto-backends", "ThinLTO Backend Jobs");
   }
 
   Error runThinLTOBackendThread(
@@ -988,7 +1135,17 @@ public:
     assert(ModuleToDefinedGVSummaries.count(ModulePath));
     const GVSummaryMapTy &DefinedGlobals =
         ModuleToDefinedGVSummaries.find(ModulePath)->second;
-    BackendThreadPool.async(
+    Timer *BackendTimer = nullptr;
+    if (BackendTimerGroup) {
+      BackendTimers.push_back(llvm::make_unique<Timer>(
+          ModulePath,
+          (ModulePath + " (estimated cost " +
+           Twine(estimateThinBackendCost(DefinedGlobals, ImportList)) + ")")
+              .str(),
+          *BackendTimerGroup));
+      BackendTimer = BackendTimers.back().get();
+    }
+    Backends.async(std::bind(
         [=](BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
             const FunctionImporter::ImportMapTy &ImportList,
             const FunctionImporter::ExportSetTy &ExportList,
@@ -997,10 +1154,15 @@ public:
             const GVSummaryMapTy &DefinedGlobals,
             MapVector<StringRef, BitcodeModule> &ModuleMap,
             const TypeIdSummariesByGuidTy &TypeIdSummariesByGuid) {
+          if (BackendTimer)
+            BackendTimer->startTimer();
           Error E = runThinLTOBackendThread(
               AddStream, Cache, Task, BM, CombinedIndex, ImportList, ExportList,
               ResolvedODR, DefinedGlobals, ModuleMap, TypeIdSummariesByGuid);
+          if (BackendTimer)
+            BackendTimer->stopTimer();
           if (E) {
+            Backends.cancel();
             std::unique_lock<std::mutex> L(ErrMu);
             if (Err)
               Err = joinErrors(std::move(*Err), std::move(E));
@@ -1010,12 +1172,14 @@ public:
         },
         BM, std::ref(CombinedIndex), std::ref(ImportList), std::ref(ExportList),
         std::ref(ResolvedODR), std::ref(DefinedGlobals), std::ref(ModuleMap),
-        std::ref(TypeIdSummariesByGuid));
+        std::ref(TypeIdSummariesByGuid)));
     return Error::success();
   }
 
+  bool canReorderJobs() const override { return true; }
+
   Error wait() override {
-    BackendThreadPool.wait();
+    Backends.wait();
     if (Err)
       return std::move(*Err);
     else
@@ -1208,15 +1372,36 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
       ThinLTO.Backend(Conf, ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
                       AddStream, Cache);
 
+  // Start the backends in input order, or with the most expensive ones first
+  // so that a large module late in the input does not end up on the critical
+  // path. Either way, task numbers follow the input order. Backends that
+  // write out their results as they go, such as the list of linked objects,
+  // keep the input order.
+  std::vector<unsigned> StartOrder(ThinLTO.ModuleMap.size());
+  std::iota(StartOrder.begin(), StartOrder.end(), 0);
+  if (ThinLTOScheduleByCost && BackendProc->canReorderJobs()) {
+    std::vector<uint64_t> Costs;
+    Costs.reserve(ThinLTO.ModuleMap.size());
+    for (auto &Mod : ThinLTO.ModuleMap)
+      Costs.push_back(estimateThinBackendCost(
+          ModuleToDefinedGVSummaries[Mod.first], ImportLists[Mod.first]));
+    std::stable_sort(
+        StartOrder.begin(), StartOrder.end(),
+        [&](unsigned L, unsigned R) { return Costs[L] > Costs[R]; });
+  }
+
   // Tasks 0 through ParallelCodeGenParallelismLevel-1 are reserved for combined
   // module and parallel code generation partitions.
-  unsigned Task = RegularLTO.ParallelCodeGenParallelismLevel;
-  for (auto &Mod : ThinLTO.ModuleMap) {
-    if (Error E = BackendProc->start(Task, Mod.second, ImportLists[Mod.first],
+  unsigned FirstTask = RegularLTO.ParallelCodeGenParallelismLevel;
+  for (unsigned I : StartOrder) {
+    auto &Mod = *(ThinLTO.ModuleMap.begin() + I);
+    LLVM_DEBUG(dbgs() << "Starting ThinLTO backend task " << FirstTask + I
+                      << " for " << Mod.first << "\n");
+    if (Error E = BackendProc->start(FirstTask + I, Mod.second,
+                                     ImportLists[Mod.first],
                                      ExportLists[Mod.first],
                                      ResolvedODR[Mod.first], ThinLTO.ModuleMap))
       return E;
-    ++Task;
   }
 
   return BackendProc->wait();
@@ -19,6 +19,7 @@
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/TypeFinder.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include <utility>
 using namespace llvm;
@@ -405,6 +406,9 @@ class IRLinker {
   DenseSet<GlobalValue *> ValuesToLink;
   std::vector<GlobalValue *> Worklist;
 
+  /// The named struct types used by SrcM, if IRMover::prepare() found them.
+  const std::vector<StructType *> *SrcStructTypes;
+
   void maybeAdd(GlobalValue *GV) {
     if (ValuesToLink.insert(GV).second)
       Worklist.push_back(GV);
@@ -507,9 +511,11 @@ public:
            IRMover::IdentifiedStructTypeSet &Set, std::unique_ptr<Module> SrcM,
            ArrayRef<GlobalValue *> ValuesToLink,
            std::function<void(GlobalValue &, IRMover::ValueAdder)> AddLazyFor,
-           bool IsPerformingImport)
+           bool IsPerformingImport,
+           const std::vector<StructType *> *SrcStructTypes = nullptr)
       : DstM(DstM), SrcM(std::move(SrcM)), AddLazyFor(std::move(AddLazyFor)),
         TypeMap(Set), GValMaterializer(*this), LValMaterializer(*this),
+        SrcStructTypes(SrcStructTypes),
         SharedMDs(SharedMDs), IsPerformingImport(IsPerformingImport),
         Mapper(ValueMap, RF_MoveDistinctMDs | RF_IgnoreMissingLocals, &TypeMap,
                &GValMaterializer),
@@ -732,7 +738,8 @@ void IRLinker::computeTypeMapping() {
   // At this point, the destination module may have a type "%foo = { i32 }" for
   // example.  When the source module got loaded into the same LLVMContext, if
   // it had the same type, it would have been renamed to "%foo.42 = { i32 }".
-  std::vector<StructType *> Types = SrcM->getIdentifiedStructTypes();
+  std::vector<StructType *> Types =
+      SrcStructTypes ? *SrcStructTypes : SrcM->getIdentifiedStructTypes();
   for (StructType *ST : Types) {
     if (!ST->hasName())
       continue;
@@ -1467,13 +1474,60 @@ IRMover::IRMover(Module &M) : Composite(M) {
   }
 }
 
+void IRMover::prepare(ArrayRef<Module *> Srcs) {
+  // A lazily loaded module gets its struct types from its materializer, which
+  // created all of them when reading the module, so nothing needs to be
+  // materialized or walked for it.
+  std::vector<Module *> ToPrepare;
+  for (Module *Src : Srcs) {
+    if (PreparedModules.count(Src))
+      continue;
+    if (Src->getMaterializer())
+      PreparedModules[Src].StructTypes = Src->getIdentifiedStructTypes();
+    else
+      ToPrepare.push_back(Src);
+  }
+
+  // TypeFinder only reads the module and the metadata it reaches, so modules
+  // sharing a context can be walked concurrently.
+  std::vector<PreparedModule> Results(ToPrepare.size());
+  parallel::for_each_n(
+      parallel::par, size_t(0), ToPrepare.size(), [&](size_t I) {
+        TypeFinder StructTypes;
+        StructTypes.run(*ToPrepare[I], /* OnlyNamed */ true);
+        Results[I].StructTypes.assign(StructTypes.begin(), StructTypes.end());
+        for (const MDNode *MD : StructTypes.getVisitedMetadata())
+          if (MD->isDistinct())
+            Results[I].DistinctMDs.push_back(MD);
+      });
+
+  for (size_t I = 0; I != ToPrepare.size(); ++I)
+    PreparedModules[ToPrepare[I]] = std::move(Results[I]);
+}
+
 Error IRMover::move(
     std::unique_ptr<Module> Src, ArrayRef<GlobalValue *> ValuesToLink,
     std::function<void(GlobalValue &, ValueAdder Add)> AddLazyFor,
     bool IsPerformingImport) {
+  PreparedModule Prepared;
+  bool IsPrepared = false;
+  auto PI = PreparedModules.find(Src.get());
+  if (PI != PreparedModules.end()) {
+    Prepared = std::move(PI->second);
+    PreparedModules.erase(PI);
+    // With ODR type uniquing, debug info metadata can be shared between
+    // source modules. Distinct nodes among it are moved into the destination
+    // by the first module that links them, after which they no longer lead to
+    // the types of the other modules.
+    IsPrepared = llvm::none_of(Prepared.DistinctMDs, [&](const MDNode *MD) {
+      return SharedMDs.count(MD);
+    });
+  }
+
   IRLinker TheIRLinker(Composite, SharedMDs, IdentifiedStructTypes,
                        std::move(Src), ValuesToLink, std::move(AddLazyFor),
-                       IsPerformingImport);
+                       IsPerformingImport,
+                       IsPrepared ? &Prepared.StructTypes : nullptr);
   Error E = TheIRLinker.run();
   Composite.dropTriviallyDeadConstantArrays();
   return E;
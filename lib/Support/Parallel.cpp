@@ -12,11 +12,14 @@
 
 #if LLVM_ENABLE_THREADS
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
-#include <stack>
+#include <deque>
 #include <thread>
+#include <vector>
 
 using namespace llvm;
 
@@ -28,6 +31,10 @@ public:
   virtual ~Executor() = default;
   virtual void add(std::function<void()> func) = 0;
 
+  /// Blocks until \p L is released. Executors may use the calling thread to
+  /// run pending work in the meantime.
+  virtual void wait(const parallel::detail::Latch &L) { L.sync(); }
+
   static Executor *getDefaultExecutor();
 };
 
@@ -59,19 +66,35 @@ Executor *Executor::getDefaultExecutor() {
 }
 
 #else
+class ThreadPoolExecutor;
+
+/// The executor and worker index of the current thread, if it is a worker.
+static LLVM_THREAD_LOCAL ThreadPoolExecutor *CurrentExecutor = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentWorker = 0;
+
 /// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+///   using per-worker deques and work stealing.
+///
+/// A worker pushes and pops its own tasks at the back of its deque, so nested
+/// work runs in filo order on the thread that created it. Once its own deque
+/// is empty, a worker steals the oldest task of another worker. Tasks added
+/// from outside the pool are distributed round-robin over the deques. A
+/// worker that waits on a TaskGroup keeps running pending tasks until the
+/// group is done, so nested TaskGroups cannot starve the pool.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(unsigned ThreadCount = hardware_concurrency())
       : Done(ThreadCount) {
+    for (unsigned I = 0; I < ThreadCount; ++I)
+      Queues.push_back(llvm::make_unique<WorkQueue>());
+
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     std::thread([&, ThreadCount] {
-      for (size_t i = 1; i < ThreadCount; ++i) {
-        std::thread([=] { work(); }).detach();
+      for (unsigned I = 1; I < ThreadCount; ++I) {
+        std::thread([=] { work(I); }).detach();
       }
-      work();
+      work(0);
     }).detach();
   }
 
@@ -84,29 +107,112 @@ public:
   }
 
   void add(std::function<void()> F) override {
-    std::unique_lock<std::mutex> Lock(Mutex);
-    WorkStack.push(F);
-    Lock.unlock();
+    unsigned Index = CurrentExecutor == this
+                         ? CurrentWorker
+                         : NextQueue.fetch_add(1) % Queues.size();
+    // Count the task before publishing it so that Pending never underflows;
+    // a worker that sees a stale count merely retries.
+    ++Pending;
+    {
+      WorkQueue &Q = *Queues[Index];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      Q.Tasks.push_back(std::move(F));
+    }
+    // Taking the lock orders this notification after any concurrent
+    // predicate check in work(), so the wakeup cannot be lost.
+    { std::lock_guard<std::mutex> Lock(Mutex); }
     Cond.notify_one();
   }
 
+  void wait(const parallel::detail::Latch &L) override {
+    if (CurrentExecutor != this)
+      return L.sync();
+
+    // We are a worker of this pool. Blocking here would take a thread away
+    // from the tasks we are waiting for, so help run them instead.
+    while (!L.done()) {
+      std::function<void()> Task;
+      if (getTask(CurrentWorker, Task)) {
+        runTask(Task);
+        continue;
+      }
+      // The remaining tasks of L are running on other workers. Sleep until
+      // one of them finishes or new work shows up.
+      std::unique_lock<std::mutex> Lock(Mutex);
+      ++Waiters;
+      Cond.wait(Lock, [&] { return Stop || Pending != 0 || L.done(); });
+      --Waiters;
+    }
+  }
+
 private:
-  void work() {
+  struct WorkQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  /// Takes the newest task from worker \p Self's own deque, or steals the
+  /// oldest task from one of the other deques.
+  bool getTask(unsigned Self, std::function<void()> &Task) {
+    {
+      WorkQueue &Q = *Queues[Self];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (!Q.Tasks.empty()) {
+        Task = std::move(Q.Tasks.back());
+        Q.Tasks.pop_back();
+        --Pending;
+        return true;
+      }
+    }
+    for (size_t I = 1, E = Queues.size(); I < E; ++I) {
+      WorkQueue &Q = *Queues[(Self + I) % E];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (!Q.Tasks.empty()) {
+        Task = std::move(Q.Tasks.front());
+        Q.Tasks.pop_front();
+        --Pending;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Runs \p Task and wakes up the workers sleeping in wait(), since the
+  /// task may have released the latch one of them is waiting on.
+  void runTask(std::function<void()> &Task) {
+    Task();
+    // Pairs with the increment of Waiters before the predicate check in
+    // wait(): either we see the waiter, or it sees the latch released.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (Waiters == 0)
+      return;
+    { std::lock_guard<std::mutex> Lock(Mutex); }
+    Cond.notify_all();
+  }
+
+  void work(unsigned Index) {
+    CurrentExecutor = this;
+    CurrentWorker = Index;
     while (true) {
+      std::function<void()> Task;
+      if (getTask(Index, Task)) {
+        runTask(Task);
+        continue;
+      }
       std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
+      Cond.wait(Lock, [&] { return Stop || Pending != 0; });
       if (Stop)
         break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
-      Lock.unlock();
-      Task();
     }
     Done.dec();
   }
 
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
+  std::atomic<size_t> Pending{0};
+  std::atomic<unsigned> NextQueue{0};
+  /// Number of workers sleeping in wait().
+  std::atomic<unsigned> Waiters{0};
+  std::vector<std::unique_ptr<WorkQueue>> Queues;
   std::mutex Mutex;
   std::condition_variable Cond;
   parallel::detail::Latch Done;
@@ -119,6 +225,8 @@ Executor *Executor::getDefaultExecutor() {
 #endif
 }
 
+parallel::detail::TaskGroup::~TaskGroup() { sync(); }
+
 void parallel::detail::TaskGroup::spawn(std::function<void()> F) {
   L.inc();
   Executor::getDefaultExecutor()->add([&, F] {
@@ -126,4 +234,8 @@ void parallel::detail::TaskGroup::spawn(std::function<void()> F) {
     L.dec();
   });
 }
+
+void parallel::detail::TaskGroup::sync() const {
+  Executor::getDefaultExecutor()->wait(L);
+}
 #endif // LLVM_ENABLE_THREADS
@@ -17,8 +17,17 @@
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+
 using namespace llvm;
 
+ThreadPool::QueuedTask ThreadPool::popTask() {
+  std::pop_heap(Tasks.begin(), Tasks.end(), runsAfter);
+  QueuedTask Next = std::move(Tasks.back());
+  Tasks.pop_back();
+  return Next;
+}
+
 #if LLVM_ENABLE_THREADS
 
 // Default to hardware_concurrency
@@ -32,7 +41,7 @@ ThreadPool::ThreadPool(unsigned ThreadCount)
   for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
     Threads.emplace_back([&] {
       while (true) {
-        PackagedTaskTy Task;
+        QueuedTask Task;
         {
           std::unique_lock<std::mutex> LockGuard(QueueLock);
           // Wait for tasks to be pushed in the queue
@@ -50,16 +59,18 @@ ThreadPool::ThreadPool(unsigned ThreadCount)
             std::unique_lock<std::mutex> LockGuard(CompletionLock);
             ++ActiveThreads;
           }
-          Task = std::move(Tasks.front());
-          Tasks.pop();
+          Task = popTask();
         }
         // Run the task we just grabbed
-        Task();
+        Task.Task();
 
         {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
+          // Adjust `ActiveThreads` and the group's count, in case someone
+          // waits on ThreadPool::wait() or ThreadPoolTaskGroup::wait()
           std::unique_lock<std::mutex> LockGuard(CompletionLock);
           --ActiveThreads;
+          if (Task.Group)
+            --Task.Group->PendingTasks;
         }
 
         // Notify task completion, in case someone waits on ThreadPool::wait()
@@ -79,7 +90,23 @@ void ThreadPool::wait() {
                            [&] { return !ActiveThreads && Tasks.empty(); });
 }
 
-std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  // Wait for the queued and running tasks of the group to complete
+  std::unique_lock<std::mutex> LockGuard(CompletionLock);
+  CompletionCondition.wait(LockGuard,
+                           [&] { return Group.PendingTasks == 0; });
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task,
+                                               ThreadPoolTaskGroup *Group,
+                                               unsigned Priority) {
+  // Skip the task if its group has been cancelled by the time it starts.
+  if (Group)
+    Task = [Task, Group] {
+      if (!Group->isCancelled())
+        Task();
+    };
+
   /// Wrap the Task in a packaged_task to return a future object.
   PackagedTaskTy PackagedTask(std::move(Task));
   auto Future = PackagedTask.get_future();
@@ -90,7 +117,13 @@ std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
     // Don't allow enqueueing after disabling the pool
     assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
 
-    Tasks.push(std::move(PackagedTask));
+    if (Group) {
+      std::unique_lock<std::mutex> LockGuard(CompletionLock);
+      ++Group->PendingTasks;
+    }
+    Tasks.push_back(
+        {std::move(PackagedTask), Group, Priority, NextSequence++});
+    std::push_heap(Tasks.begin(), Tasks.end(), runsAfter);
   }
   QueueCondition.notify_one();
   return Future.share();
@@ -123,19 +156,43 @@ ThreadPool::ThreadPool(unsigned ThreadCount)
 void ThreadPool::wait() {
   // Sequential implementation running the tasks
   while (!Tasks.empty()) {
-    auto Task = std::move(Tasks.front());
-    Tasks.pop();
-    Task();
+    QueuedTask Task = popTask();
+    Task.Task();
+    if (Task.Group)
+      --Task.Group->PendingTasks;
   }
 }
 
-std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  // Sequential implementation: run queued tasks in order until the group's
+  // tasks are done.
+  while (Group.PendingTasks) {
+    QueuedTask Task = popTask();
+    Task.Task();
+    if (Task.Group)
+      --Task.Group->PendingTasks;
+  }
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task,
+                                               ThreadPoolTaskGroup *Group,
+                                               unsigned Priority) {
+  // Skip the task if its group has been cancelled by the time it starts.
+  if (Group)
+    Task = [Task, Group] {
+      if (!Group->isCancelled())
+        Task();
+    };
+
   // Get a Future with launch::deferred execution using std::async
   auto Future = std::async(std::launch::deferred, std::move(Task)).share();
   // Wrap the future so that both ThreadPool::wait() can operate and the
   // returned future can be sync'ed on.
   PackagedTaskTy PackagedTask([Future]() { Future.get(); });
-  Tasks.push(std::move(PackagedTask));
+  if (Group)
+    ++Group->PendingTasks;
+  Tasks.push_back({std::move(PackagedTask), Group, Priority, NextSequence++});
+  std::push_heap(Tasks.begin(), Tasks.end(), runsAfter);
   return Future;
 }
 
@@ -938,8 +938,9 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
     auto GetInlineCost = [&](CallSite CS) {
       Function &Callee = *CS.getCalledFunction();
       auto &CalleeTTI = FAM.getResult<TargetIRAnalysis>(Callee);
+      auto &CalleeCache = FAM.getResult<InlineCostCacheAnalysis>(Callee);
       return getInlineCost(CS, Params, CalleeTTI, GetAssumptionCache, {GetBFI},
-                           PSI, &ORE);
+                           PSI, &ORE, &CalleeCache);
     };
 
     // Now process as many calls as we have within this caller in the sequnece.
@@ -998,6 +999,11 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       DidInline = true;
       InlinedCallees.insert(&Callee);
 
+      // The caller's walks are stale now, and it may be a callee of the
+      // remaining call sites.
+      if (auto *CallerCache = FAM.getCachedResult<InlineCostCacheAnalysis>(F))
+        CallerCache->clear();
+
       ORE.emit([&]() {
         bool AlwaysInline = OIC->isAlways();
         StringRef RemarkName = AlwaysInline ? "AlwaysInline" : "Inlined";
@@ -29,6 +29,8 @@
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
 #include "llvm/Analysis/MemoryLocation.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/MemorySSAUpdater.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -73,6 +75,8 @@ STATISTIC(NumRedundantStores, "Number of redundant stores deleted");
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 STATISTIC(NumCompletePartials, "Number of stores dead by later partials");
+STATISTIC(NumMemorySSAPreserved,
+          "Number of changed functions whose MemorySSA was kept up to date");
 STATISTIC(NumModifiedStores, "Number of stores modified");
 
 static cl::opt<bool>
@@ -97,7 +101,8 @@ using InstOverlapIntervalsTy = DenseMap<Instruction *, OverlapIntervalsTy>;
 /// If ValueSet is non-null, remove any deleted instructions from it as well.
 static void
 deleteDeadInstruction(Instruction *I, BasicBlock::iterator *BBI,
-                      MemoryDependenceResults &MD, const TargetLibraryInfo &TLI,
+                      MemoryDependenceResults &MD, MemorySSAUpdater *MSSAU,
+                      const TargetLibraryInfo &TLI,
                       InstOverlapIntervalsTy &IOL,
                       DenseMap<Instruction*, size_t> *InstrOrdering,
                       SmallSetVector<Value *, 16> *ValueSet = nullptr) {
@@ -122,6 +127,8 @@ deleteDeadInstruction(Instruction *I, BasicBlock::iterator *BBI,
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
     MD.removeInstruction(DeadInst);
+    if (MSSAU)
+      MSSAU->removeMemoryAccess(DeadInst);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -653,7 +660,8 @@ static void findUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
 /// Handle frees of entire structures whose dependency is a store
 /// to a field of that structure.
 static bool handleFree(CallInst *F, AliasAnalysis *AA,
-                       MemoryDependenceResults *MD, DominatorTree *DT,
+                       MemoryDependenceResults *MD, MemorySSAUpdater *MSSAU,
+                       DominatorTree *DT,
                        const TargetLibraryInfo *TLI,
                        InstOverlapIntervalsTy &IOL,
                        DenseMap<Instruction*, size_t> *InstrOrdering) {
@@ -690,7 +698,8 @@ static bool handleFree(CallInst *F, AliasAnalysis *AA,
 
       // DCE instructions only used to calculate that store.
       BasicBlock::iterator BBI(Dependency);
-      deleteDeadInstruction(Dependency, &BBI, *MD, *TLI, IOL, InstrOrdering);
+      deleteDeadInstruction(Dependency, &BBI, *MD, MSSAU, *TLI, IOL,
+                            InstrOrdering);
       ++NumFastStores;
       MadeChange = true;
 
@@ -746,6 +755,7 @@ static void removeAccessedObjects(const MemoryLocation &LoadedLoc,
 /// ret void
 static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
                              MemoryDependenceResults *MD,
+                             MemorySSAUpdater *MSSAU,
                              const TargetLibraryInfo *TLI,
                              InstOverlapIntervalsTy &IOL,
                              DenseMap<Instruction*, size_t> *InstrOrdering) {
@@ -808,7 +818,8 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
                    << '\n');
 
         // DCE instructions only used to calculate that store.
-        deleteDeadInstruction(Dead, &BBI, *MD, *TLI, IOL, InstrOrdering, &DeadStackObjects);
+        deleteDeadInstruction(Dead, &BBI, *MD, MSSAU, *TLI, IOL, InstrOrdering,
+                              &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -819,7 +830,8 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
     if (isInstructionTriviallyDead(&*BBI, TLI)) {
       LLVM_DEBUG(dbgs() << "DSE: Removing trivially dead instruction:\n  DEAD: "
                         << *&*BBI << '\n');
-      deleteDeadInstruction(&*BBI, &BBI, *MD, *TLI, IOL, InstrOrdering, &DeadStackObjects);
+      deleteDeadInstruction(&*BBI, &BBI, *MD, MSSAU, *TLI, IOL, InstrOrdering,
+                            &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -1021,7 +1033,7 @@ static bool removePartiallyOverlappedStores(AliasAnalysis *AA,
 
 static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
                                AliasAnalysis *AA, MemoryDependenceResults *MD,
-                               const DataLayout &DL,
+                               MemorySSAUpdater *MSSAU, const DataLayout &DL,
                                const TargetLibraryInfo *TLI,
                                InstOverlapIntervalsTy &IOL,
                                DenseMap<Instruction*, size_t> *InstrOrdering) {
@@ -1040,7 +1052,7 @@ static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
           dbgs() << "DSE: Remove Store Of Load from same pointer:\n  LOAD: "
                  << *DepLoad << "\n  STORE: " << *SI << '\n');
 
-      deleteDeadInstruction(SI, &BBI, *MD, *TLI, IOL, InstrOrdering);
+      deleteDeadInstruction(SI, &BBI, *MD, MSSAU, *TLI, IOL, InstrOrdering);
       ++NumRedundantStores;
       return true;
     }
@@ -1058,7 +1070,7 @@ static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
           dbgs() << "DSE: Remove null store to the calloc'ed object:\n  DEAD: "
                  << *Inst << "\n  OBJECT: " << *UnderlyingPointer << '\n');
 
-      deleteDeadInstruction(SI, &BBI, *MD, *TLI, IOL, InstrOrdering);
+      deleteDeadInstruction(SI, &BBI, *MD, MSSAU, *TLI, IOL, InstrOrdering);
       ++NumRedundantStores;
       return true;
     }
@@ -1067,7 +1079,8 @@ static bool eliminateNoopStore(Instruction *Inst, BasicBlock::iterator &BBI,
 }
 
 static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
-                                MemoryDependenceResults *MD, DominatorTree *DT,
+                                MemoryDependenceResults *MD,
+                                MemorySSAUpdater *MSSAU, DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
   const DataLayout &DL = BB.getModule()->getDataLayout();
   bool MadeChange = false;
@@ -1085,7 +1098,7 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
   for (BasicBlock::iterator BBI = BB.begin(), BBE = BB.end(); BBI != BBE; ) {
     // Handle 'free' calls specially.
     if (CallInst *F = isFreeCall(&*BBI, TLI)) {
-      MadeChange |= handleFree(F, AA, MD, DT, TLI, IOL, &InstrOrdering);
+      MadeChange |= handleFree(F, AA, MD, MSSAU, DT, TLI, IOL, &InstrOrdering);
       // Increment BBI after handleFree has potentially deleted instructions.
       // This ensures we maintain a valid iterator.
       ++BBI;
@@ -1106,7 +1119,8 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
       continue;
 
     // eliminateNoopStore will update in iterator, if necessary.
-    if (eliminateNoopStore(Inst, BBI, AA, MD, DL, TLI, IOL, &InstrOrdering)) {
+    if (eliminateNoopStore(Inst, BBI, AA, MD, MSSAU, DL, TLI, IOL,
+                           &InstrOrdering)) {
       MadeChange = true;
       continue;
     }
@@ -1190,7 +1204,8 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
                             << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          deleteDeadInstruction(DepWrite, &BBI, *MD, *TLI, IOL, &InstrOrdering);
+          deleteDeadInstruction(DepWrite, &BBI, *MD, MSSAU, *TLI, IOL,
+                                &InstrOrdering);
           ++NumFastStores;
           MadeChange = true;
 
@@ -1261,14 +1276,24 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
             SI->copyMetadata(*DepWrite, MDToKeep);
             ++NumModifiedStores;
 
+            // The merged store takes the place of the earlier one in the
+            // def chain; the earlier one's users move to it on deletion.
+            if (MSSAU) {
+              MemorySSA *MSSA = MSSAU->getMemorySSA();
+              auto *NewDef = cast<MemoryDef>(MSSAU->createMemoryAccessBefore(
+                  SI, nullptr, MSSA->getMemoryAccess(DepWrite)));
+              MSSAU->insertDef(NewDef);
+            }
+
             // Remove earlier, wider, store
             size_t Idx = InstrOrdering.lookup(DepWrite);
             InstrOrdering.erase(DepWrite);
             InstrOrdering.insert(std::make_pair(SI, Idx));
 
             // Delete the old stores and now-dead instructions that feed them.
-            deleteDeadInstruction(Inst, &BBI, *MD, *TLI, IOL, &InstrOrdering);
-            deleteDeadInstruction(DepWrite, &BBI, *MD, *TLI, IOL,
+            deleteDeadInstruction(Inst, &BBI, *MD, MSSAU, *TLI, IOL,
+                                  &InstrOrdering);
+            deleteDeadInstruction(DepWrite, &BBI, *MD, MSSAU, *TLI, IOL,
                                   &InstrOrdering);
             MadeChange = true;
 
@@ -1304,21 +1329,33 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
   // If this block ends in a return, unwind, or unreachable, all allocas are
   // dead at its end, which means stores to them are also dead.
   if (BB.getTerminator()->getNumSuccessors() == 0)
-    MadeChange |= handleEndBlock(BB, AA, MD, TLI, IOL, &InstrOrdering);
+    MadeChange |= handleEndBlock(BB, AA, MD, MSSAU, TLI, IOL, &InstrOrdering);
 
   return MadeChange;
 }
 
 static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
-                                MemoryDependenceResults *MD, DominatorTree *DT,
+                                MemoryDependenceResults *MD, MemorySSA *MSSA,
+                                DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
+  // DSE only deletes and merges stores without touching the CFG, so an
+  // existing MemorySSA is cheap to keep up to date for the passes after it.
+  std::unique_ptr<MemorySSAUpdater> MSSAU;
+  if (MSSA)
+    MSSAU = make_unique<MemorySSAUpdater>(MSSA);
+
   bool MadeChange = false;
   for (BasicBlock &BB : F)
     // Only check non-dead blocks.  Dead blocks may have strange pointer
     // cycles that will confuse alias analysis.
     if (DT->isReachableFromEntry(&BB))
-      MadeChange |= eliminateDeadStores(BB, AA, MD, DT, TLI);
+      MadeChange |= eliminateDeadStores(BB, AA, MD, MSSAU.get(), DT, TLI);
 
+  if (MadeChange && MSSA) {
+    ++NumMemorySSAPreserved;
+    if (VerifyMemorySSA)
+      MSSA->verifyMemorySSA();
+  }
   return MadeChange;
 }
 
@@ -1330,14 +1367,17 @@ PreservedAnalyses DSEPass::run(Function &F, FunctionAnalysisManager &AM) {
   DominatorTree *DT = &AM.getResult<DominatorTreeAnalysis>(F);
   MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   const TargetLibraryInfo *TLI = &AM.getResult<TargetLibraryAnalysis>(F);
+  auto *MSSAAnalysis = AM.getCachedResult<MemorySSAAnalysis>(F);
+  MemorySSA *MSSA = MSSAAnalysis ? &MSSAAnalysis->getMSSA() : nullptr;
 
-  if (!eliminateDeadStores(F, AA, MD, DT, TLI))
+  if (!eliminateDeadStores(F, AA, MD, MSSA, DT, TLI))
     return PreservedAnalyses::all();
 
   PreservedAnalyses PA;
   PA.preserveSet<CFGAnalyses>();
   PA.preserve<GlobalsAA>();
   PA.preserve<MemoryDependenceAnalysis>();
+  PA.preserve<MemorySSAAnalysis>();
   return PA;
 }
 
@@ -1362,8 +1402,10 @@ public:
         &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     const TargetLibraryInfo *TLI =
         &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
+    auto *MSSAWP = getAnalysisIfAvailable<MemorySSAWrapperPass>();
+    MemorySSA *MSSA = MSSAWP ? &MSSAWP->getMSSA() : nullptr;
 
-    return eliminateDeadStores(F, AA, MD, DT, TLI);
+    return eliminateDeadStores(F, AA, MD, MSSA, DT, TLI);
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
@@ -1375,6 +1417,7 @@ public:
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
     AU.addPreserved<MemoryDependenceWrapperPass>();
+    AU.addPreserved<MemorySSAWrapperPass>();
   }
 };
 
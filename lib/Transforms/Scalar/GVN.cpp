@@ -35,6 +35,8 @@
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/MemorySSAUpdater.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/PHITransAddr.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -93,6 +95,8 @@ STATISTIC(NumGVNBlocks, "Number of blocks merged");
 STATISTIC(NumGVNSimpl,  "Number of instructions simplified");
 STATISTIC(NumGVNEqProp, "Number of equalities propagated");
 STATISTIC(NumPRELoad,   "Number of loads PRE'd");
+STATISTIC(NumMemorySSAPreserved,
+          "Number of changed functions whose MemorySSA was kept up to date");
 
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
@@ -637,13 +641,21 @@ PreservedAnalyses GVN::run(Function &F, FunctionAnalysisManager &AM) {
   auto &MemDep = AM.getResult<MemoryDependenceAnalysis>(F);
   auto *LI = AM.getCachedResult<LoopAnalysis>(F);
   auto &ORE = AM.getResult<OptimizationRemarkEmitterAnalysis>(F);
-  bool Changed = runImpl(F, AC, DT, TLI, AA, &MemDep, LI, &ORE);
+  auto *MSSA = AM.getCachedResult<MemorySSAAnalysis>(F);
+  bool Changed = runImpl(F, AC, DT, TLI, AA, &MemDep, LI, &ORE,
+                         MSSA ? &MSSA->getMSSA() : nullptr);
   if (!Changed)
     return PreservedAnalyses::all();
   PreservedAnalyses PA;
   PA.preserve<DominatorTreeAnalysis>();
   PA.preserve<GlobalsAA>();
   PA.preserve<TargetLibraryAnalysis>();
+  // MemorySSA is only kept while the CFG is left alone, so the CFG analyses
+  // (and the alias analyses that depend on them) survive too.
+  if (this->MSSA) {
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<MemorySSAAnalysis>();
+  }
   return PA;
 }
 
@@ -795,6 +807,9 @@ Value *AvailableValue::MaterializeAdjustedValue(LoadInst *LI,
       Res = Load;
     } else {
       Res = getLoadValueForLoad(Load, Offset, LoadTy, InsertPt, DL);
+      // The load may have been widened in place; MemorySSA does not know
+      // about the new load.
+      gvn.invalidateMemorySSA();
       // We would like to use gvn.markInstructionForDeletion here, but we can't
       // because the load is already memoized into the leader map table that GVN
       // tracks.  It is potentially possible to remove the load from the table,
@@ -1261,6 +1276,22 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
     // Add the newly created load.
     ValuesPerBlock.push_back(AvailableValueInBlock::get(UnavailablePred,
                                                         NewLoad));
+    if (MSSAU) {
+      // Keep the new access ahead of an access for the terminator (e.g. an
+      // invoke), matching the instruction order.
+      MemoryUseOrDef *NewAccess;
+      auto *Term = UnavailablePred->getTerminator();
+      if (auto *TermAccess = MSSAU->getMemorySSA()->getMemoryAccess(Term))
+        NewAccess = MSSAU->createMemoryAccessBefore(NewLoad, nullptr,
+                                                    TermAccess);
+      else
+        NewAccess = cast<MemoryUseOrDef>(MSSAU->createMemoryAccessInBB(
+            NewLoad, nullptr, UnavailablePred, MemorySSA::End));
+      if (auto *NewDef = dyn_cast<MemoryDef>(NewAccess))
+        MSSAU->insertDef(NewDef, /*RenameUses=*/true);
+      else
+        MSSAU->insertUse(cast<MemoryUse>(NewAccess));
+    }
     MD->invalidateCachedPointerInfo(LoadPtr);
     LLVM_DEBUG(dbgs() << "GVN INSERTED " << *NewLoad << '\n');
   }
@@ -1393,6 +1424,7 @@ bool GVN::processAssumeIntrinsic(IntrinsicInst *IntrinsicI) {
       new StoreInst(UndefValue::get(Int8Ty),
                     Constant::getNullValue(Int8Ty->getPointerTo()),
                     IntrinsicI);
+      invalidateMemorySSA();
     }
     markInstructionForDeletion(IntrinsicI);
     return false;
@@ -2004,7 +2036,7 @@ bool GVN::processInstruction(Instruction *I) {
 bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
                   const TargetLibraryInfo &RunTLI, AAResults &RunAA,
                   MemoryDependenceResults *RunMD, LoopInfo *LI,
-                  OptimizationRemarkEmitter *RunORE) {
+                  OptimizationRemarkEmitter *RunORE, MemorySSA *RunMSSA) {
   AC = &RunAC;
   DT = &RunDT;
   VN.setDomTree(DT);
@@ -2015,6 +2047,11 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   OI = &OrderedInstrs;
   VN.setMemDep(MD);
   ORE = RunORE;
+  MSSA = RunMSSA;
+  std::unique_ptr<MemorySSAUpdater> Updater;
+  if (MSSA)
+    Updater = llvm::make_unique<MemorySSAUpdater>(MSSA);
+  MSSAU = Updater.get();
 
   bool Changed = false;
   bool ShouldContinue = true;
@@ -2025,8 +2062,10 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
     BasicBlock *BB = &*FI++;
 
     bool removedBlock = MergeBlockIntoPredecessor(BB, DT, LI, MD);
-    if (removedBlock)
+    if (removedBlock) {
       ++NumGVNBlocks;
+      invalidateMemorySSA();
+    }
 
     Changed |= removedBlock;
   }
@@ -2061,6 +2100,13 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
   // iteration.
   DeadBlocks.clear();
 
+  if (Changed && MSSA) {
+    ++NumMemorySSAPreserved;
+    if (VerifyMemorySSA)
+      MSSA->verifyMemorySSA();
+  }
+  MSSAU = nullptr;
+
   return Changed;
 }
 
@@ -2102,6 +2148,7 @@ bool GVN::processBlock(BasicBlock *BB) {
       LLVM_DEBUG(dbgs() << "GVN removed: " << *I << '\n');
       salvageDebugInfo(*I);
       if (MD) MD->removeInstruction(I);
+      if (MSSAU) MSSAU->removeMemoryAccess(I);
       LLVM_DEBUG(verifyRemoved(I));
       if (MaybeFirstICF == I) {
         // We have erased the first ICF in block. The map needs to be updated.
@@ -2325,6 +2372,8 @@ bool GVN::performScalarPRE(Instruction *CurInst) {
   LLVM_DEBUG(dbgs() << "GVN PRE removed: " << *CurInst << '\n');
   if (MD)
     MD->removeInstruction(CurInst);
+  if (MSSAU)
+    MSSAU->removeMemoryAccess(CurInst);
   LLVM_DEBUG(verifyRemoved(CurInst));
   bool InvalidateImplicitCF =
       FirstImplicitControlFlowInsts.lookup(CurInst->getParent()) == CurInst;
@@ -2373,6 +2422,8 @@ BasicBlock *GVN::splitCriticalEdges(BasicBlock *Pred, BasicBlock *Succ) {
       SplitCriticalEdge(Pred, Succ, CriticalEdgeSplittingOptions(DT));
   if (MD)
     MD->invalidateCachedPredecessors();
+  if (BB)
+    invalidateMemorySSA();
   return BB;
 }
 
@@ -2387,6 +2438,7 @@ bool GVN::splitCriticalEdges() {
                       CriticalEdgeSplittingOptions(DT));
   } while (!toSplit.empty());
   if (MD) MD->invalidateCachedPredecessors();
+  invalidateMemorySSA();
   return true;
 }
 
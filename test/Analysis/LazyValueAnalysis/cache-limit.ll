@@ -0,0 +1,32 @@
+; RUN: opt < %s -correlated-propagation -S | FileCheck %s
+; RUN: opt < %s -correlated-propagation -lvi-max-cached-block-values=2 -S \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -correlated-propagation -lvi-max-cached-block-values=2 \
+; RUN:   -disable-output -stats 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; Check that LVI keeps giving the same answers when its cache is kept under a
+; limit by evicting values between queries.
+
+; STATS: {{[1-9][0-9]*}} lazy-value-info {{.*}}Number of cached block values evicted
+
+define i1 @test(i32 %a, i32 %b) {
+; CHECK-LABEL: @test(
+entry:
+  %c1 = icmp ult i32 %a, 10
+  br i1 %c1, label %then, label %else
+
+then:
+  %c2 = icmp ult i32 %b, 20
+  br i1 %c2, label %then2, label %else
+
+then2:
+; CHECK: %r = and i1 true, true
+  %x = icmp ult i32 %a, 11
+  %y = icmp ult i32 %b, 21
+  %r = and i1 %x, %y
+  ret i1 %r
+
+else:
+  ret i1 false
+}
@@ -0,0 +1,105 @@
+; RUN: llc %s -enable-machine-outliner -mtriple=aarch64-unknown-unknown \
+; RUN:   -o - | FileCheck %s -check-prefix=ALL
+; RUN: llc %s -enable-machine-outliner -mtriple=aarch64-unknown-unknown \
+; RUN:   -machine-outliner-skip-hot-blocks -o - | FileCheck %s
+
+; Check that with -machine-outliner-skip-hot-blocks, only the sequences in
+; the cold functions are outlined.
+
+; ALL-LABEL: hot1:
+; ALL: OUTLINED_FUNCTION_
+; ALL-LABEL: cold1:
+; ALL: OUTLINED_FUNCTION_
+
+; CHECK-LABEL: hot1:
+; CHECK-NOT: OUTLINED_FUNCTION_
+; CHECK-LABEL: hot2:
+; CHECK-NOT: OUTLINED_FUNCTION_
+; CHECK-LABEL: cold1:
+; CHECK: OUTLINED_FUNCTION_
+; CHECK-LABEL: cold2:
+; CHECK: OUTLINED_FUNCTION_
+
+define void @hot1() #0 !prof !14 {
+  %1 = alloca i32, align 4
+  %2 = alloca i32, align 4
+  %3 = alloca i32, align 4
+  %4 = alloca i32, align 4
+  %5 = alloca i32, align 4
+  %6 = alloca i32, align 4
+  store i32 1, i32* %1, align 4
+  store i32 2, i32* %2, align 4
+  store i32 3, i32* %3, align 4
+  store i32 4, i32* %4, align 4
+  store i32 5, i32* %5, align 4
+  store i32 6, i32* %6, align 4
+  ret void
+}
+
+define void @hot2() #0 !prof !14 {
+  %1 = alloca i32, align 4
+  %2 = alloca i32, align 4
+  %3 = alloca i32, align 4
+  %4 = alloca i32, align 4
+  %5 = alloca i32, align 4
+  %6 = alloca i32, align 4
+  store i32 1, i32* %1, align 4
+  store i32 2, i32* %2, align 4
+  store i32 3, i32* %3, align 4
+  store i32 4, i32* %4, align 4
+  store i32 5, i32* %5, align 4
+  store i32 6, i32* %6, align 4
+  ret void
+}
+
+define void @cold1() #0 !prof !15 {
+  %1 = alloca i32, align 4
+  %2 = alloca i32, align 4
+  %3 = alloca i32, align 4
+  %4 = alloca i32, align 4
+  %5 = alloca i32, align 4
+  %6 = alloca i32, align 4
+  store i32 7, i32* %1, align 4
+  store i32 8, i32* %2, align 4
+  store i32 9, i32* %3, align 4
+  store i32 10, i32* %4, align 4
+  store i32 11, i32* %5, align 4
+  store i32 12, i32* %6, align 4
+  ret void
+}
+
+define void @cold2() #0 !prof !15 {
+  %1 = alloca i32, align 4
+  %2 = alloca i32, align 4
+  %3 = alloca i32, align 4
+  %4 = alloca i32, align 4
+  %5 = alloca i32, align 4
+  %6 = alloca i32, align 4
+  store i32 7, i32* %1, align 4
+  store i32 8, i32* %2, align 4
+  store i32 9, i32* %3, align 4
+  store i32 10, i32* %4, align 4
+  store i32 11, i32* %5, align 4
+  store i32 12, i32* %6, align 4
+  ret void
+}
+
+attributes #0 = { noredzone nounwind ssp uwtable "no-frame-pointer-elim"="false" "target-cpu"="cyclone" }
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"ProfileSummary", !1}
+!1 = !{!2, !3, !4, !5, !6, !7, !8, !9}
+!2 = !{!"ProfileFormat", !"InstrProf"}
+!3 = !{!"TotalCount", i64 10000}
+!4 = !{!"MaxCount", i64 1000}
+!5 = !{!"MaxInternalCount", i64 1}
+!6 = !{!"MaxFunctionCount", i64 1000}
+!7 = !{!"NumCounts", i64 4}
+!8 = !{!"NumFunctions", i64 4}
+!9 = !{!"DetailedSummary", !10}
+!10 = !{!11, !12, !13}
+!11 = !{i32 10000, i64 1000, i32 1}
+!12 = !{i32 999000, i64 1000, i32 3}
+!13 = !{i32 999999, i64 1, i32 4}
+!14 = !{!"function_entry_count", i64 1000}
+!15 = !{!"function_entry_count", i64 1}
@@ -1,4 +1,5 @@
 ; RUN: llc -enable-machine-outliner -mtriple=x86_64-apple-darwin < %s | FileCheck %s
+; RUN: llc -enable-machine-outliner -outliner-suffix-array -mtriple=x86_64-apple-darwin < %s | FileCheck %s
 
 @x = global i32 0, align 4
 
@@ -1,4 +1,7 @@
 ; RUN: llc < %s -march=x86 -regalloc=greedy --debug-only=regalloc 2>&1 | FileCheck %s
+; RUN: llc < %s -march=x86 -regalloc=greedy --debug-only=regalloc \
+; RUN:   -grow-region-complexity-budget=1 -verify-machineinstrs 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=BUDGET
 
 ; REQUIRES: asserts
 
@@ -25,6 +28,11 @@
 ; CHECK-NEXT: $ebp	static = 
 ; CHECK: Split for $ebp
 
+; With a budget of a single block, every region split candidate is given up.
+; BUDGET: RS_Split Cascade 1
+; BUDGET: over the complexity budget.
+; BUDGET-NOT: Split for $ebp
+
 ; Function Attrs: nounwind
 define i32 @foo(i32* %array, i32 %cond1, i32 %val) local_unnamed_addr #0 {
 entry:
@@ -0,0 +1,3 @@
+%pair = type { i32, i32 }
+
+@a = global %pair { i32 1, i32 2 }
@@ -0,0 +1,4 @@
+%node = type { %node*, i32 }
+
+@n = external global %node*
+@b = global %node { %node* null, i32 3 }
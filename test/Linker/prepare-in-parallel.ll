@@ -0,0 +1,27 @@
+; Test that preparing the input files for linking in parallel maps their types
+; the same way as linking them one at a time.
+
+; RUN: llvm-link -S %s %p/Inputs/prepare-in-parallel-a.ll \
+; RUN:   %p/Inputs/prepare-in-parallel-b.ll | FileCheck %s
+; RUN: llvm-link -S -prepare-in-parallel %s %p/Inputs/prepare-in-parallel-a.ll \
+; RUN:   %p/Inputs/prepare-in-parallel-b.ll | FileCheck %s
+
+; Bitcode inputs are loaded lazily and prepared without being materialized.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-as %p/Inputs/prepare-in-parallel-a.ll -o %t-a.bc
+; RUN: llvm-as %p/Inputs/prepare-in-parallel-b.ll -o %t-b.bc
+; RUN: llvm-link -S -prepare-in-parallel %t.bc %t-a.bc %t-b.bc | FileCheck %s
+
+; CHECK-DAG: %pair = type { i32, i32 }
+; CHECK-DAG: %node = type { %node*, i32 }
+
+; CHECK: @p = global %pair zeroinitializer
+; CHECK: @n = global %node* null
+; CHECK: @a = global %pair { i32 1, i32 2 }
+; CHECK: @b = global %node { %node* null, i32 3 }
+
+%pair = type { i32, i32 }
+%node = type opaque
+
+@p = global %pair zeroinitializer
+@n = global %node* null
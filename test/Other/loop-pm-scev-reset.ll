@@ -0,0 +1,44 @@
+; Test that the loop pass adaptor drops ScalarEvolution, and with it every loop
+; analysis, once its expression arena grows beyond
+; -scev-arena-reset-threshold, and that the next loop pipeline builds them
+; again.
+;
+; RUN: opt -disable-output -disable-verify -debug-pass-manager %s 2>&1 \
+; RUN:     -scev-arena-reset-threshold=1 \
+; RUN:     -passes='loop(indvars),loop(no-op-loop)' \
+; RUN:     | FileCheck %s --check-prefix=RESET
+; RUN: opt -disable-output -disable-verify -debug-pass-manager %s 2>&1 \
+; RUN:     -passes='loop(indvars),loop(no-op-loop)' \
+; RUN:     | FileCheck %s --check-prefix=KEEP
+
+; RESET: Running analysis: ScalarEvolutionAnalysis
+; RESET: Running pass: IndVarSimplifyPass
+; RESET: Invalidating all non-preserved analyses
+; RESET-DAG: Clearing all analysis results for:
+; RESET-DAG: Invalidating analysis: ScalarEvolutionAnalysis
+; RESET-DAG: Invalidating analysis: InnerAnalysisManagerProxy<{{.*}}Loop
+; RESET: Running analysis: ScalarEvolutionAnalysis
+; RESET-NEXT: Running analysis: InnerAnalysisManagerProxy<{{.*}}Loop
+; RESET: Running pass: NoOpLoopPass
+
+; KEEP: Running analysis: ScalarEvolutionAnalysis
+; KEEP: Running pass: IndVarSimplifyPass
+; KEEP-NOT: Invalidating analysis: ScalarEvolutionAnalysis
+; KEEP-NOT: Running analysis: ScalarEvolutionAnalysis
+; KEEP: Running pass: NoOpLoopPass
+
+define void @f(i32* %p, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %gep = getelementptr i32, i32* %p, i32 %i
+  store i32 %i, i32* %gep
+  %i.next = add nsw i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,18 @@
+; Test that -time-passes-trace records the size of the SCC a call graph pass
+; ran on, not that of the whole module.
+;
+; RUN: opt -functionattrs -time-passes-trace=%t.json -S < %s -o /dev/null
+; RUN: FileCheck %s < %t.json
+
+; CHECK: {"args":{"ir-size-after":1,"ir-size-before":1,"malloc-delta":{{-?[0-9]+}},"target":"g"},"cat":"pass","dur":{{[0-9]+}},"name":"functionattrs"
+; CHECK: {"args":{"ir-size-after":3,"ir-size-before":3,"malloc-delta":{{-?[0-9]+}},"target":"f"},"cat":"pass","dur":{{[0-9]+}},"name":"functionattrs"
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 1
+  %b = call i32 @g(i32 %a)
+  ret i32 %b
+}
+
+define i32 @g(i32 %x) {
+  ret i32 %x
+}
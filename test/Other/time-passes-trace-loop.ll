@@ -0,0 +1,21 @@
+; Test that -time-passes-trace records the size of the loop a loop pass ran
+; on, not that of the whole function.
+;
+; RUN: opt -licm -time-passes-trace=%t.json -S < %s -o /dev/null
+; RUN: FileCheck %s < %t.json
+
+; CHECK: {"args":{"ir-size-after":4,"ir-size-before":4,"malloc-delta":{{-?[0-9]+}},"target":"loop"},"cat":"pass","dur":{{[0-9]+}},"name":"licm"
+
+define i32 @f(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %i.next
+}
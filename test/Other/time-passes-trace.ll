@@ -0,0 +1,15 @@
+; Test that -time-passes-trace records each pass run with the IR unit it ran
+; on and the size of that unit before and after.
+;
+; RUN: opt -instcombine -time-passes-trace=%t.json -S < %s -o /dev/null
+; RUN: FileCheck %s < %t.json
+
+; CHECK: {"displayTimeUnit":"ms","traceEvents":[
+; CHECK-SAME: {"args":{"ir-size-after":1,"ir-size-before":3,"malloc-delta":{{-?[0-9]+}},"target":"f"},"cat":"pass","dur":{{[0-9]+}},"name":"instcombine","ph":"X","pid":1,"tid":{{[0-9]+}},"ts":{{[0-9]+}}}
+; CHECK-SAME: {"args":{"ir-size-after":1,"ir-size-before":1,"malloc-delta":{{-?[0-9]+}},"target":"<stdin>"},"cat":"pass"
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 1
+  %b = sub i32 %a, %x
+  ret i32 %b
+}
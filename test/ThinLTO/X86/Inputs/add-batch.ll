@@ -0,0 +1,7 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @regular(i32 %a) {
+  %b = add i32 %a, 1
+  ret i32 %b
+}
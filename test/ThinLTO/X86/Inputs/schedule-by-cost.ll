@@ -0,0 +1,12 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @big(i32 %a) {
+  %b = mul i32 %a, %a
+  %c = add i32 %b, %a
+  %d = mul i32 %c, %b
+  %e = add i32 %d, %c
+  %f = mul i32 %e, %d
+  %g = add i32 %f, %e
+  ret i32 %g
+}
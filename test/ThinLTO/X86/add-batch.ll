@@ -0,0 +1,44 @@
+; Test that adding the inputs as a batch gives the same result as adding them
+; one at a time, and that the time spent is reported as its own phase.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/schedule-by-cost.ll -o %t2.bc
+; RUN: opt %p/Inputs/add-batch.ll -o %t3.bc
+
+; RUN: llvm-lto2 run -o %t.o %t1.bc %t2.bc %t3.bc -save-temps \
+; RUN:   -r=%t1.bc,main,plx \
+; RUN:   -r=%t1.bc,big,l \
+; RUN:   -r=%t1.bc,regular,l \
+; RUN:   -r=%t2.bc,big,pl \
+; RUN:   -r=%t3.bc,regular,pl
+; RUN: llvm-lto2 run -o %t.batch.o %t1.bc %t2.bc %t3.bc -save-temps \
+; RUN:   -add-batch -time-passes \
+; RUN:   -r=%t1.bc,main,plx \
+; RUN:   -r=%t1.bc,big,l \
+; RUN:   -r=%t1.bc,regular,l \
+; RUN:   -r=%t2.bc,big,pl \
+; RUN:   -r=%t3.bc,regular,pl 2>&1 | FileCheck %s
+; RUN: cmp %t.o.resolution.txt %t.batch.o.resolution.txt
+; RUN: cmp %t.o.0 %t.batch.o.0
+; RUN: cmp %t.o.1 %t.batch.o.1
+; RUN: cmp %t.o.2 %t.batch.o.2
+
+; CHECK: LTO
+; CHECK: Add Input Files
+
+; An input that cannot be read fails the whole batch.
+; RUN: not llvm-lto2 run -o %t.err.o %t1.bc %s -add-batch 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=ERR
+; ERR: llvm-lto2: failed to read input files: {{.*}}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @big(i32)
+declare i32 @regular(i32)
+
+define i32 @main(i32 %a) {
+  %r = call i32 @big(i32 %a)
+  %s = call i32 @regular(i32 %r)
+  ret i32 %s
+}
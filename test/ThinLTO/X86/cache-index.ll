@@ -0,0 +1,74 @@
+; Test the indexed cache: entries are recorded in llvmcache.index, hits are
+; served from the index, and entries are evicted by size without pruning.
+
+; RUN: opt -module-hash -module-summary %s -o %t.bc
+; RUN: opt -module-hash -module-summary %p/Inputs/cache.ll -o %t2.bc
+
+; RUN: rm -Rf %t.cache
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: ls %t.cache | count 3
+; RUN: FileCheck %s --check-prefix=INDEX < %t.cache/llvmcache.index
+
+; INDEX: llvmcache-index-v1
+; INDEX-NEXT: {{[0-9A-F]+}} {{[0-9]+}} {{[0-9]+}}
+; INDEX-NEXT: {{[0-9A-F]+}} {{[0-9]+}} {{[0-9]+}}
+; INDEX-NOT: {{.}}
+
+; A second link hits the cache and produces the same objects.
+; RUN: cp %t.o.1 %t.first.o.1
+; RUN: cp %t.o.2 %t.first.o.2
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: ls %t.cache | count 3
+; RUN: cmp %t.o.1 %t.first.o.1
+; RUN: cmp %t.o.2 %t.first.o.2
+
+; Without an index file, the index is rebuilt from the cache directory.
+; RUN: rm %t.cache/llvmcache.index
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s --check-prefix=INDEX < %t.cache/llvmcache.index
+
+; A file missing from the index, because its writer died before recording it,
+; is only picked up when the index is rebuilt.
+; RUN: echo foo > %t.cache/llvmcache-0123456789ABCDEF
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s --check-prefix=INDEX < %t.cache/llvmcache.index
+; RUN: rm %t.cache/llvmcache.index
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: FileCheck %s --check-prefix=ORPHAN < %t.cache/llvmcache.index
+
+; ORPHAN: 0123456789ABCDEF 4 {{[0-9]+}}
+
+; With a size limit smaller than any entry, all entries are evicted.
+; RUN: llvm-lto2 run -o %t.o %t2.bc %t.bc -cache-dir %t.cache -cache-index \
+; RUN:  -cache-max-size=1 \
+; RUN:  -r=%t2.bc,_main,plx \
+; RUN:  -r=%t2.bc,_globalfunc,lx \
+; RUN:  -r=%t.bc,_globalfunc,plx
+; RUN: ls %t.cache | count 1
+; RUN: FileCheck %s --check-prefix=EMPTY < %t.cache/llvmcache.index
+
+; EMPTY: llvmcache-index-v1
+; EMPTY-NOT: {{.}}
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define void @globalfunc() #0 {
+entry:
+  ret void
+}
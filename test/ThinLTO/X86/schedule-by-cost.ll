@@ -0,0 +1,51 @@
+; Test that starting the backends by estimated cost does not change the task
+; numbering, and that the per-job timing report shows the estimates.
+; REQUIRES: asserts
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/schedule-by-cost.ll -o %t2.bc
+
+; RUN: llvm-lto2 run -o %t.o %t1.bc %t2.bc -thinlto-threads 1 \
+; RUN:   -r=%t1.bc,main,plx \
+; RUN:   -r=%t1.bc,big,l \
+; RUN:   -r=%t2.bc,big,pl
+; RUN: llvm-lto2 run -o %t.cost.o %t1.bc %t2.bc -thinlto-threads 1 \
+; RUN:   -thinlto-schedule-by-cost -thinlto-time-backends \
+; RUN:   -r=%t1.bc,main,plx \
+; RUN:   -r=%t1.bc,big,l \
+; RUN:   -r=%t2.bc,big,pl 2>&1 | FileCheck %s
+; RUN: cmp %t.o.1 %t.cost.o.1
+; RUN: cmp %t.o.2 %t.cost.o.2
+
+; CHECK: ThinLTO Backend Jobs
+; CHECK-DAG: schedule-by-cost.ll.tmp1.bc (estimated cost {{[0-9]+}})
+; CHECK-DAG: schedule-by-cost.ll.tmp2.bc (estimated cost {{[0-9]+}})
+
+; The second module defines the larger function, so its backend starts first.
+; Writing distributed indexes keeps the input order.
+; RUN: llvm-lto2 run -o %t.order.o %t1.bc %t2.bc -thinlto-threads 1 \
+; RUN:   -thinlto-schedule-by-cost -debug-only=lto \
+; RUN:   -r=%t1.bc,main,plx \
+; RUN:   -r=%t1.bc,big,l \
+; RUN:   -r=%t2.bc,big,pl 2>&1 | FileCheck %s --check-prefix=ORDER
+; RUN: llvm-lto2 run -o %t.index.o %t1.bc %t2.bc -thinlto-distributed-indexes \
+; RUN:   -thinlto-schedule-by-cost -debug-only=lto \
+; RUN:   -r=%t1.bc,main,plx \
+; RUN:   -r=%t1.bc,big,l \
+; RUN:   -r=%t2.bc,big,pl 2>&1 | FileCheck %s --check-prefix=INPUT
+
+; ORDER: Starting ThinLTO backend task 2 for {{.*}}schedule-by-cost.ll.tmp2.bc
+; ORDER-NEXT: Starting ThinLTO backend task 1 for {{.*}}schedule-by-cost.ll.tmp1.bc
+
+; INPUT: Starting ThinLTO backend task 1 for {{.*}}schedule-by-cost.ll.tmp1.bc
+; INPUT-NEXT: Starting ThinLTO backend task 2 for {{.*}}schedule-by-cost.ll.tmp2.bc
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i32 @big(i32)
+
+define i32 @main(i32 %a) {
+  %r = call i32 @big(i32 %a)
+  ret i32 %r
+}
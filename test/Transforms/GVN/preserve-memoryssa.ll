@@ -0,0 +1,27 @@
+; RUN: opt < %s -debug-pass-manager -verify-memoryssa -stats \
+; RUN:   -passes='require<memoryssa>,dse,gvn,require<memoryssa>' 2>&1 -S \
+; RUN:   | FileCheck %s
+; REQUIRES: asserts
+
+; Check that DSE and GVN keep a cached MemorySSA up to date instead of
+; forcing it to be rebuilt for the next user.
+
+; CHECK: Running analysis: MemorySSAAnalysis on test
+; CHECK: Running pass: DSEPass on test
+; CHECK-NOT: Running analysis: MemorySSAAnalysis on test
+; CHECK: Running pass: GVN on test
+; CHECK-NOT: Running analysis: MemorySSAAnalysis on test
+; CHECK: Finished llvm::Function pass manager run.
+
+; CHECK-DAG: 1 dse {{.*}}Number of changed functions whose MemorySSA was kept up to date
+; CHECK-DAG: 1 gvn {{.*}}Number of changed functions whose MemorySSA was kept up to date
+
+define i32 @test(i32* %p, i32* %q) {
+entry:
+  store i32 1, i32* %p
+  store i32 2, i32* %p
+  %a = load i32, i32* %q
+  %b = load i32, i32* %q
+  %c = add i32 %a, %b
+  ret i32 %c
+}
@@ -0,0 +1,41 @@
+; RUN: opt < %s -passes='cgscc(inline)' -inline-threshold=8 -stats -S 2>&1 \
+; RUN:   | FileCheck %s
+; REQUIRES: asserts
+
+; Check that call sites passing the same constants to a callee share one walk
+; of its body, and that the shared walk gives the same decision.
+
+define i32 @callee(i32 %x, i32 %y) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %big, label %small
+
+big:
+  %a = mul i32 %y, %y
+  %b = mul i32 %a, %y
+  %d = mul i32 %b, %y
+  %e = mul i32 %d, %y
+  %f = mul i32 %e, %y
+  ret i32 %f
+
+small:
+  ret i32 %y
+}
+
+define i32 @caller1(i32 %y) {
+; CHECK-LABEL: @caller1(
+; CHECK-NOT: call i32 @callee
+; CHECK: ret i32
+  %r1 = call i32 @callee(i32 1, i32 %y)
+  %r2 = call i32 @callee(i32 1, i32 %r1)
+  ret i32 %r2
+}
+
+define i32 @caller2(i32 %x, i32 %y) {
+; CHECK-LABEL: @caller2(
+; CHECK: call i32 @callee(i32 %x, i32 %y)
+  %r = call i32 @callee(i32 %x, i32 %y)
+  ret i32 %r
+}
+
+; CHECK: 1 inline-cost {{.*}}Number of call sites analyzed by reusing a walk of the callee
@@ -0,0 +1,75 @@
+; RUN: opt < %s -basicaa -licm -enable-mssa-loop-dependency -verify-memoryssa \
+; RUN:   -S | FileCheck %s
+; RUN: opt < %s -aa-pipeline=basic-aa -enable-mssa-loop-dependency \
+; RUN:   -verify-memoryssa -passes='require<opt-remark-emit>,loop(licm)' -S \
+; RUN:   | FileCheck %s
+
+; Check that LICM keeps MemorySSA valid as it hoists, sinks and promotes
+; memory operations. -verify-memoryssa checks it after each loop.
+
+; CHECK-LABEL: @hoist(
+; CHECK: entry:
+; CHECK-NEXT: %v = load i32, i32* %p
+; CHECK: loop:
+; CHECK-NOT: load
+; CHECK: exit:
+define i32 @hoist(i32* noalias %p, i32* noalias %q, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* %p
+  %gep = getelementptr i32, i32* %q, i32 %i
+  store i32 %v, i32* %gep
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i32 %v
+}
+
+; CHECK-LABEL: @sink(
+; CHECK: loop:
+; CHECK-NOT: load
+; CHECK: exit:
+; CHECK-NEXT: %v.le = load i32, i32* %p
+; CHECK-NEXT: ret i32 %v.le
+define i32 @sink(i32* %p, i1 %c) {
+entry:
+  br label %loop
+
+loop:
+  %v = load i32, i32* %p
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %v
+}
+
+; CHECK-LABEL: @promote(
+; CHECK: entry:
+; CHECK-NEXT: %p.promoted = load i32, i32* %p
+; CHECK: loop:
+; CHECK-NOT: load
+; CHECK-NOT: store
+; CHECK: exit:
+; CHECK-NEXT: %[[LCSSA:.*]] = phi i32 [ %inc, %loop ]
+; CHECK-NEXT: store i32 %[[LCSSA]], i32* %p
+define void @promote(i32* noalias %p, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* %p
+  %inc = add i32 %v, 1
+  store i32 %inc, i32* %p
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -86,6 +86,12 @@ static cl::opt<bool>
     DisableLazyLoad("disable-lazy-loading",
                     cl::desc("Disable lazy module loading"));
 
+static cl::opt<bool>
+    PrepareInParallel("prepare-in-parallel",
+                      cl::desc("Load all input files before linking, so "
+                               "that they can be prepared for linking in "
+                               "parallel"));
+
 static cl::opt<bool>
     OutputAssembly("S", cl::desc("Write output as LLVM assembly"), cl::Hidden);
 
@@ -280,8 +286,23 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
   unsigned ApplicableFlags = Flags & Linker::Flags::OverrideFromSrc;
   // Similar to some flags, internalization doesn't apply to the first file.
   bool InternalizeLinkedSymbols = false;
-  for (const auto &File : Files) {
-    std::unique_ptr<Module> M = loadFile(argv0, File, Context);
+
+  std::vector<std::unique_ptr<Module>> Loaded;
+  if (PrepareInParallel) {
+    for (const auto &File : Files)
+      Loaded.push_back(loadFile(argv0, File, Context));
+    std::vector<Module *> ToPrepare;
+    for (auto &M : Loaded)
+      if (M)
+        ToPrepare.push_back(M.get());
+    L.prepare(ToPrepare);
+  }
+
+  for (unsigned I = 0; I != Files.size(); ++I) {
+    const std::string &File = Files[I];
+    std::unique_ptr<Module> M = PrepareInParallel
+                                    ? std::move(Loaded[I])
+                                    : loadFile(argv0, File, Context);
     if (!M.get()) {
       errs() << argv0 << ": ";
       WithColor::error() << " loading file '" << File << "'\n";
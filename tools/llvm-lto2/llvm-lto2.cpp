@@ -49,6 +49,16 @@ static cl::opt<std::string> OutputFilename("o", cl::Required,
 static cl::opt<std::string> CacheDir("cache-dir", cl::desc("Cache Directory"),
                                      cl::value_desc("directory"));
 
+static cl::opt<bool>
+    CacheIndex("cache-index",
+               cl::desc("Keep an index of the cache directory and evict "
+                        "least recently used entries above -cache-max-size"));
+
+static cl::opt<uint64_t>
+    CacheMaxSize("cache-max-size", cl::init(0),
+                 cl::desc("Maximum size of an indexed cache in bytes "
+                          "(0 means no limit)"));
+
 static cl::opt<std::string> OptPipeline("opt-pipeline",
                                         cl::desc("Optimizer Pipeline"),
                                         cl::value_desc("pipeline"));
@@ -65,6 +75,11 @@ static cl::opt<bool>
                                        "import files for the "
                                        "distributed backend case"));
 
+static cl::opt<bool>
+    AddBatch("add-batch",
+             cl::desc("Read the input files in parallel and add them to the "
+                      "link as a single batch"));
+
 static cl::opt<int> Threads("thinlto-threads",
                             cl::init(llvm::heavyweight_hardware_concurrency()));
 
@@ -257,11 +272,29 @@ static int run(int argc, char **argv) {
     Backend = createInProcessThinBackend(Threads);
   LTO Lto(std::move(Conf), std::move(Backend));
 
+  std::vector<std::unique_ptr<InputFile>> BatchInputs;
+  std::vector<std::vector<SymbolResolution>> BatchRes;
+  if (AddBatch) {
+    std::vector<MemoryBufferRef> MBRefs;
+    for (std::string F : InputFilenames) {
+      MBs.push_back(check(MemoryBuffer::getFile(F), F));
+      MBRefs.push_back(MBs.back()->getMemBufferRef());
+    }
+    BatchInputs =
+        check(InputFile::create(MBRefs), "failed to read input files");
+  }
+
   bool HasErrors = false;
-  for (std::string F : InputFilenames) {
-    std::unique_ptr<MemoryBuffer> MB = check(MemoryBuffer::getFile(F), F);
-    std::unique_ptr<InputFile> Input =
-        check(InputFile::create(MB->getMemBufferRef()), F);
+  for (unsigned I = 0; I != InputFilenames.size(); ++I) {
+    const std::string &F = InputFilenames[I];
+    std::unique_ptr<MemoryBuffer> MB;
+    std::unique_ptr<InputFile> Input;
+    if (AddBatch) {
+      Input = std::move(BatchInputs[I]);
+    } else {
+      MB = check(MemoryBuffer::getFile(F), F);
+      Input = check(InputFile::create(MB->getMemBufferRef()), F);
+    }
 
     std::vector<SymbolResolution> Res;
     for (const InputFile::Symbol &Sym : Input->symbols()) {
@@ -281,10 +314,20 @@ static int run(int argc, char **argv) {
     if (HasErrors)
       continue;
 
+    if (AddBatch) {
+      BatchInputs[I] = std::move(Input);
+      BatchRes.push_back(std::move(Res));
+      continue;
+    }
+
     MBs.push_back(std::move(MB));
     check(Lto.add(std::move(Input), Res), F);
   }
 
+  if (AddBatch && !HasErrors)
+    check(Lto.add(std::move(BatchInputs), BatchRes),
+          "failed to add input files");
+
   if (!CommandLineResolutions.empty()) {
     HasErrors = true;
     for (auto UnusedRes : CommandLineResolutions)
@@ -310,7 +353,10 @@ static int run(int argc, char **argv) {
   };
 
   NativeObjectCache Cache;
-  if (!CacheDir.empty())
+  if (!CacheDir.empty() && CacheIndex)
+    Cache = check(localIndexedCache(CacheDir, AddBuffer, CacheMaxSize),
+                  "failed to create cache");
+  else if (!CacheDir.empty())
     Cache = check(localCache(CacheDir, AddBuffer), "failed to create cache");
 
   check(Lto.run(AddStream, Cache), "LTO::run failed");
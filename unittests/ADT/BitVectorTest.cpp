@@ -836,5 +836,75 @@ TYPED_TEST(BitVectorTest, Iterators) {
   for (unsigned Bit : ToFill.set_bits())
     EXPECT_EQ(List[i++], Bit);
 }
+
+// Checks the whole-vector operations against bit-by-bit results for sizes
+// around the word and word-block boundaries.
+TYPED_TEST(BitVectorTest, AgreesWithBitByBit) {
+  const unsigned Sizes[] = {1, 63, 64, 65, 255, 256, 257, 600};
+  auto makeVector = [](unsigned Size, unsigned Seed) {
+    TypeParam Vec(Size);
+    // A sparse pattern that leaves whole blocks of words empty.
+    for (unsigned I = Seed % 7; I < Size; I += 97 + Seed)
+      Vec.set(I);
+    return Vec;
+  };
+
+  for (unsigned LSize : Sizes) {
+    for (unsigned RSize : Sizes) {
+      for (unsigned Seed = 0; Seed != 3; ++Seed) {
+        TypeParam L = makeVector(LSize, Seed);
+        TypeParam R = makeVector(RSize, Seed + 1);
+
+        unsigned Count = 0;
+        int First = -1;
+        for (unsigned I = 0; I != LSize; ++I) {
+          if (!L.test(I))
+            continue;
+          ++Count;
+          if (First == -1)
+            First = I;
+        }
+        EXPECT_EQ(Count, L.count());
+        EXPECT_EQ(Count != 0, L.any());
+        EXPECT_EQ(First, L.find_first());
+        for (int I = L.find_first(), Prev = -1; I != -1;
+             Prev = I, I = L.find_next(I)) {
+          for (int J = Prev + 1; J < I; ++J)
+            EXPECT_FALSE(L.test(J));
+          EXPECT_TRUE(L.test(I));
+        }
+
+        bool AnyCommon = false, AnyNotInR = false, Equal = true;
+        for (unsigned I = 0; I != std::max(LSize, RSize); ++I) {
+          bool LBit = I < LSize && L.test(I);
+          bool RBit = I < RSize && R.test(I);
+          AnyCommon |= LBit && RBit;
+          AnyNotInR |= LBit && !RBit;
+          Equal &= LBit == RBit;
+        }
+        EXPECT_EQ(AnyCommon, L.anyCommon(R));
+        EXPECT_EQ(AnyNotInR, L.test(R));
+        if (LSize == RSize)
+          EXPECT_EQ(Equal, L == R);
+
+        TypeParam And = L, Or = L, Xor = L, Reset = L;
+        And &= R;
+        Or |= R;
+        Xor ^= R;
+        Reset.reset(R);
+        for (unsigned I = 0; I != std::max(LSize, RSize); ++I) {
+          bool LBit = I < LSize && L.test(I);
+          bool RBit = I < RSize && R.test(I);
+          if (I < And.size())
+            EXPECT_EQ(LBit && RBit, And.test(I));
+          EXPECT_EQ(LBit || RBit, Or.test(I));
+          EXPECT_EQ(LBit != RBit, Xor.test(I));
+          if (I < LSize)
+            EXPECT_EQ(LBit && !RBit, Reset.test(I));
+        }
+      }
+    }
+  }
+}
 }
 #endif
@@ -1390,5 +1390,78 @@ TEST_F(ScalarEvolutionsTest, SCEVCacheNSW) {
   EXPECT_FALSE(I->hasNoSignedWrap());
 }
 
+// Erasing a value a cached backedge-taken count depends on must drop that
+// count, plain or predicated, without the count being forgotten explicitly.
+TEST_F(ScalarEvolutionsTest, SCEVBackedgeTakenCountErasedOperand) {
+  LLVMContext C;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(
+      "define void @plain(i64* %p) { "
+      "entry: "
+      "  %n = load i64, i64* %p "
+      "  br label %loop "
+      "loop: "
+      "  %iv = phi i64 [ 0, %entry ], [ %iv.next, %loop ] "
+      "  %iv.next = add nsw i64 %iv, 1 "
+      "  %cond = icmp slt i64 %iv.next, %n "
+      "  br i1 %cond, label %loop, label %exit "
+      "exit: "
+      "  ret void "
+      "} "
+      "define void @predicated(i64* %p) { "
+      "entry: "
+      "  %n = load i64, i64* %p "
+      "  br label %loop "
+      "loop: "
+      "  %iv = phi i8 [ 0, %entry ], [ %iv.next, %loop ] "
+      "  %iv.next = add i8 %iv, 1 "
+      "  %iv.ext = zext i8 %iv.next to i64 "
+      "  %cond = icmp ult i64 %iv.ext, %n "
+      "  br i1 %cond, label %loop, label %exit "
+      "exit: "
+      "  ret void "
+      "} ",
+      Err, C);
+
+  ASSERT_TRUE(M && "Could not parse module?");
+  ASSERT_TRUE(!verifyModule(*M) && "Must have been well formed!");
+
+  // Makes the loop exit after 100 iterations instead of after %n.
+  auto ReplaceBound = [](Function &F) {
+    auto *N = getInstructionByName(F, "n");
+    auto *Cond = cast<ICmpInst>(getInstructionByName(F, "cond"));
+    Cond->setOperand(1, ConstantInt::get(N->getType(), 100));
+    N->eraseFromParent();
+  };
+
+  runWithSE(*M, "plain", [&](Function &F, LoopInfo &LI, ScalarEvolution &SE) {
+    auto *L = *LI.begin();
+    const SCEV *EC = SE.getBackedgeTakenCount(L);
+    EXPECT_FALSE(isa<SCEVCouldNotCompute>(EC));
+    EXPECT_FALSE(isa<SCEVConstant>(EC));
+
+    ReplaceBound(F);
+    const SCEV *NewEC = SE.getBackedgeTakenCount(L);
+    ASSERT_TRUE(isa<SCEVConstant>(NewEC));
+    EXPECT_EQ(cast<SCEVConstant>(NewEC)->getAPInt().getLimitedValue(), 99u);
+  });
+
+  runWithSE(*M, "predicated",
+            [&](Function &F, LoopInfo &LI, ScalarEvolution &SE) {
+    auto *L = *LI.begin();
+    SCEVUnionPredicate Preds;
+    const SCEV *EC = SE.getPredicatedBackedgeTakenCount(L, Preds);
+    EXPECT_FALSE(isa<SCEVCouldNotCompute>(EC));
+    EXPECT_FALSE(isa<SCEVConstant>(EC));
+    EXPECT_FALSE(Preds.isAlwaysTrue());
+
+    ReplaceBound(F);
+    SCEVUnionPredicate NewPreds;
+    const SCEV *NewEC = SE.getPredicatedBackedgeTakenCount(L, NewPreds);
+    ASSERT_TRUE(isa<SCEVConstant>(NewEC));
+    EXPECT_EQ(cast<SCEVConstant>(NewEC)->getAPInt().getLimitedValue(), 99u);
+  });
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
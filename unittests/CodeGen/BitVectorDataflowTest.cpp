@@ -0,0 +1,157 @@
+//===- BitVectorDataflowTest.cpp - Gen/kill dataflow solver tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/BitVectorDataflow.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+std::unique_ptr<Module> parseIR(LLVMContext &C, const char *IR) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, C);
+  if (!M)
+    Err.print("BitVectorDataflowTest", errs());
+  return M;
+}
+
+BasicBlock *getBlock(Function &F, StringRef Name) {
+  for (BasicBlock &BB : F)
+    if (BB.getName() == Name)
+      return &BB;
+  llvm_unreachable("No block with that name");
+}
+
+BitVector makeBV(std::initializer_list<unsigned> Bits) {
+  BitVector BV(2);
+  for (unsigned Bit : Bits)
+    BV.set(Bit);
+  return BV;
+}
+
+SparseBitVector<> makeSBV(std::initializer_list<unsigned> Bits) {
+  SparseBitVector<> SBV;
+  for (unsigned Bit : Bits)
+    SBV.set(Bit);
+  return SBV;
+}
+
+// Checks that the bits set in BV are exactly Expected, whatever its size.
+void expectBits(const BitVector &BV, std::initializer_list<unsigned> Expected) {
+  BitVector Resized = BV;
+  Resized.resize(2);
+  EXPECT_EQ(makeBV(Expected), Resized);
+}
+
+const char *LoopIR = R"(
+  define void @f(i1 %c) {
+  entry:
+    br label %loop
+  loop:
+    br i1 %c, label %body, label %exit
+  body:
+    br label %loop
+  dead:
+    br label %exit
+  exit:
+    ret void
+  }
+)";
+
+TEST(BitVectorDataflowTest, ForwardLoop) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, LoopIR);
+  Function &F = *M->getFunction("f");
+  BasicBlock *Entry = getBlock(F, "entry"), *Loop = getBlock(F, "loop"),
+             *Body = getBlock(F, "body"), *Exit = getBlock(F, "exit");
+
+  BitVectorDataflow<Function *> Dataflow(&F);
+  EXPECT_FALSE(Dataflow.contains(getBlock(F, "dead")));
+  ASSERT_EQ(4u, Dataflow.blocks().size());
+  EXPECT_EQ(Entry, Dataflow.blocks().front());
+
+  Dataflow[Entry].Gen = makeBV({0});
+  Dataflow[Body].Gen = makeBV({1});
+  Dataflow[Body].Kill = makeBV({0});
+  Dataflow[Exit].Kill = makeBV({0, 1});
+  Dataflow.solve();
+
+  expectBits(Dataflow[Entry].In, {});
+  expectBits(Dataflow[Entry].Out, {0});
+  expectBits(Dataflow[Loop].In, {0, 1});
+  expectBits(Dataflow[Loop].Out, {0, 1});
+  expectBits(Dataflow[Body].In, {0, 1});
+  expectBits(Dataflow[Body].Out, {1});
+  expectBits(Dataflow[Exit].In, {0, 1});
+  expectBits(Dataflow[Exit].Out, {});
+}
+
+TEST(BitVectorDataflowTest, BackwardLiveness) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, LoopIR);
+  Function &F = *M->getFunction("f");
+  BasicBlock *Entry = getBlock(F, "entry"), *Loop = getBlock(F, "loop"),
+             *Body = getBlock(F, "body"), *Exit = getBlock(F, "exit");
+
+  // Variable 1 is defined in entry and used in the loop body, which redefines
+  // variable 0 before it is used after the loop.
+  BitVectorDataflow<Function *, SparseBitVector<>> Dataflow(&F,
+                                                            /*Forward=*/false);
+  EXPECT_EQ(Entry, Dataflow.blocks().back());
+  Dataflow[Entry].Kill = makeSBV({1});
+  Dataflow[Body].Gen = makeSBV({1});
+  Dataflow[Body].Kill = makeSBV({0});
+  Dataflow[Exit].Gen = makeSBV({0});
+  Dataflow.solve();
+
+  // For a backward problem In is live-out and Out is live-in.
+  EXPECT_EQ(makeSBV({0}), Dataflow[Entry].Out);
+  EXPECT_EQ(makeSBV({0, 1}), Dataflow[Entry].In);
+  EXPECT_EQ(makeSBV({0, 1}), Dataflow[Loop].Out);
+  EXPECT_EQ(makeSBV({0, 1}), Dataflow[Body].In);
+  EXPECT_EQ(makeSBV({1}), Dataflow[Body].Out);
+  EXPECT_EQ(makeSBV({0}), Dataflow[Exit].Out);
+  EXPECT_TRUE(Dataflow[Exit].In.empty());
+}
+
+TEST(BitVectorDataflowTest, AcyclicSettlesInOneSweep) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, R"(
+    define void @f(i1 %c) {
+    entry:
+      br i1 %c, label %left, label %right
+    left:
+      br label %join
+    right:
+      br label %join
+    join:
+      ret void
+    }
+  )");
+  Function &F = *M->getFunction("f");
+
+  BitVectorDataflow<Function *> Dataflow(&F);
+  Dataflow[getBlock(F, "entry")].Gen = makeBV({0});
+  Dataflow[getBlock(F, "left")].Gen = makeBV({1});
+  Dataflow[getBlock(F, "right")].Kill = makeBV({0});
+  EXPECT_EQ(1u, Dataflow.solve());
+
+  expectBits(Dataflow[getBlock(F, "join")].In, {0, 1});
+  expectBits(Dataflow[getBlock(F, "join")].Out, {0, 1});
+  expectBits(Dataflow[getBlock(F, "right")].Out, {});
+}
+
+} // end anonymous namespace
@@ -8,8 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ExecutionEngine/Orc/SymbolStringPool.h"
+#include "llvm/Config/llvm-config.h"
 #include "gtest/gtest.h"
 
+#include <string>
+#include <thread>
+#include <vector>
+
 using namespace llvm;
 using namespace llvm::orc;
 
@@ -51,4 +56,34 @@ TEST(SymbolStringPool, ClearDeadEntries) {
   EXPECT_TRUE(SP.empty()) << "pool should be empty";
 }
 
+TEST(SymbolStringPool, ConcurrentIntern) {
+#if LLVM_ENABLE_THREADS
+  constexpr unsigned NumThreads = 4;
+  constexpr unsigned NumNames = 1000;
+  SymbolStringPool SP;
+
+  // Every thread interns every name, starting at a different point, so that
+  // threads race to add the same names as well as to look them up.
+  std::vector<std::vector<SymbolStringPtr>> Interned(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads.emplace_back([&, T]() {
+      for (unsigned I = 0; I != NumNames; ++I)
+        Interned[T].push_back(
+            SP.intern("sym" + std::to_string((I + T * 250) % NumNames)));
+    });
+  for (auto &Th : Threads)
+    Th.join();
+
+  for (unsigned T = 1; T != NumThreads; ++T)
+    for (unsigned I = 0; I != NumNames; ++I)
+      EXPECT_EQ(Interned[0][(I + T * 250) % NumNames], Interned[T][I])
+          << "Threads got different entries for the same name";
+
+  Interned.clear();
+  SP.clearDeadEntries();
+  EXPECT_TRUE(SP.empty()) << "pool should be empty";
+#endif
+}
+
 }
@@ -9,11 +9,15 @@
 
 #include "llvm/IR/PassManager.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <atomic>
 
 using namespace llvm;
 
@@ -772,4 +776,173 @@ TEST_F(PassManagerTest, IndirectAnalysisInvalidation) {
   // three functions.
   EXPECT_EQ(3 * 4 * 3, FunctionCount);
 }
+
+TEST(ParallelPassManagerTest, Basic) {
+  LLVMContext Context;
+  std::string IR;
+  const int NumFunctions = 64;
+  for (int I = 0; I != NumFunctions; ++I)
+    IR += "define i32 @f" + std::to_string(I) + "(i32 %x) {\n"
+          "entry:\n"
+          "  ret i32 %x\n"
+          "}\n";
+  std::unique_ptr<Module> M = parseIR(Context, IR.c_str());
+  ASSERT_TRUE(M);
+
+  FunctionAnalysisManager FAM;
+  ModuleAnalysisManager MAM;
+  int FunctionAnalysisRuns = 0;
+  FAM.registerPass([&] { return TestFunctionAnalysis(FunctionAnalysisRuns); });
+  MAM.registerPass([&] { return FunctionAnalysisManagerModuleProxy(FAM); });
+  FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(MAM); });
+
+  // Populate the sequential cache so that we can check it is invalidated.
+  for (Function &F : *M)
+    FAM.getResult<TestFunctionAnalysis>(F);
+  EXPECT_EQ(NumFunctions, FunctionAnalysisRuns);
+
+  // Each function touches every kind of context-wide table: constants, types,
+  // names, metadata and the module's symbol table.
+  std::atomic<int> PassRuns(0);
+  auto BuildPipeline = [&](FunctionPassManager &FPM,
+                           FunctionAnalysisManager &WorkerFAM) {
+    int *WorkerRuns = new int(0);
+    WorkerFAM.registerPass([&] { return TestFunctionAnalysis(*WorkerRuns); });
+    FPM.addPass(LambdaPass([&](Function &F, FunctionAnalysisManager &AM) {
+      ++PassRuns;
+      AM.getResult<TestFunctionAnalysis>(F);
+      LLVMContext &Ctx = F.getContext();
+      IRBuilder<> B(&F.getEntryBlock().front());
+      Value *Sum = B.CreateAdd(
+          &*F.arg_begin(),
+          ConstantInt::get(B.getInt32Ty(), F.getName().size() % 4), "sum");
+      Sum = B.CreateAdd(Sum, ConstantExpr::getPtrToInt(
+                                 F.getParent()->getOrInsertGlobal(
+                                     "g", ArrayType::get(B.getInt8Ty(), 4)),
+                                 B.getInt32Ty()));
+      cast<Instruction>(Sum)->setMetadata(
+          "test.md", MDNode::get(Ctx, MDString::get(Ctx, "shared")));
+      F.getEntryBlock().getTerminator()->setOperand(0, Sum);
+      return PreservedAnalyses::none();
+    }));
+    return std::shared_ptr<int>(WorkerRuns);
+  };
+
+  ModulePassManager MPM;
+  MPM.addPass(ParallelModuleToFunctionPassAdaptor(BuildPipeline, 4));
+  MPM.run(*M, MAM);
+
+  EXPECT_EQ(NumFunctions, PassRuns);
+  EXPECT_FALSE(Context.isConcurrent());
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  EXPECT_EQ(1u, M->getGlobalList().size());
+
+  // All functions were rewritten in place, so every cached result in the
+  // sequential manager must have been dropped.
+  for (Function &F : *M)
+    FAM.getResult<TestFunctionAnalysis>(F);
+  EXPECT_EQ(2 * NumFunctions, FunctionAnalysisRuns);
+
+  MDNode *Shared = nullptr;
+  for (Function &F : *M) {
+    auto *Sum = cast<Instruction>(
+        cast<ReturnInst>(F.getEntryBlock().getTerminator())->getReturnValue());
+    MDNode *MD = Sum->getMetadata("test.md");
+    ASSERT_TRUE(MD);
+    // Metadata is uniqued across threads.
+    if (Shared)
+      EXPECT_EQ(Shared, MD);
+    Shared = MD;
+  }
+}
+
+TEST(ParallelPassManagerTest, NewGlobalsAreDeterministic) {
+  LLVMContext Context;
+  std::string IR;
+  const int NumFunctions = 32;
+  for (int I = 0; I != NumFunctions; ++I)
+    IR += "define i32 @f" + std::to_string(I) + "(i32 %x) {\n"
+          "entry:\n"
+          "  ret i32 %x\n"
+          "}\n";
+  std::unique_ptr<Module> M = parseIR(Context, IR.c_str());
+  ASSERT_TRUE(M);
+
+  FunctionAnalysisManager FAM;
+  ModuleAnalysisManager MAM;
+  MAM.registerPass([&] { return FunctionAnalysisManagerModuleProxy(FAM); });
+
+  // Every function creates private globals with the same names, one of them
+  // only referenced from another's initializer and two of them used by the
+  // same instruction. It calls a shared declaration and declares a function
+  // whose name sorts in the opposite order.
+  auto BuildPipeline = [&](FunctionPassManager &FPM,
+                           FunctionAnalysisManager &) {
+    FPM.addPass(LambdaPass([&](Function &F, FunctionAnalysisManager &) {
+      Module &M = *F.getParent();
+      int Index = std::stoi(F.getName().drop_front().str());
+      IRBuilder<> B(&F.getEntryBlock().front());
+      auto *Str = new GlobalVariable(M, B.getInt32Ty(), /*isConstant*/ true,
+                                     GlobalValue::PrivateLinkage,
+                                     B.getInt32(Index), "str");
+      auto *Elt = new GlobalVariable(M, B.getInt32Ty(), /*isConstant*/ true,
+                                     GlobalValue::PrivateLinkage,
+                                     B.getInt32(Index), "elt");
+      auto *Tab = new GlobalVariable(M, Elt->getType(), /*isConstant*/ true,
+                                     GlobalValue::PrivateLinkage, Elt, "tab");
+      Constant *Shared = M.getOrInsertFunction("shared", B.getInt32Ty(),
+                                               B.getInt32Ty());
+      Constant *Callee = M.getOrInsertFunction(
+          "decl" + std::to_string(NumFunctions - Index),
+          B.getInt32Ty(), B.getInt32Ty());
+      Constant *Both =
+          ConstantExpr::getAdd(ConstantExpr::getPtrToInt(Tab, B.getInt32Ty()),
+                               ConstantExpr::getPtrToInt(Str, B.getInt32Ty()));
+      Value *Sum = B.CreateAdd(&*F.arg_begin(), Both);
+      Sum = B.CreateCall(Shared, Sum);
+      Sum = B.CreateCall(Callee, Sum);
+      F.getEntryBlock().getTerminator()->setOperand(0, Sum);
+      return PreservedAnalyses::none();
+    }));
+    return std::shared_ptr<void>();
+  };
+
+  ModulePassManager MPM;
+  MPM.addPass(ParallelModuleToFunctionPassAdaptor(BuildPipeline, 4));
+  MPM.run(*M, MAM);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // Globals are named and ordered after the functions that created them and
+  // the order the instruction reaches them in.
+  auto Suffix = [](int I) { return I ? "." + std::to_string(I) : ""; };
+  auto GI = M->global_begin();
+  for (int I = 0; I != NumFunctions; ++I) {
+    ASSERT_EQ("tab" + Suffix(I), GI->getName());
+    GlobalVariable *Tab = &*GI++;
+    ASSERT_EQ("elt" + Suffix(I), GI->getName());
+    EXPECT_EQ(Tab->getInitializer(), &*GI);
+    EXPECT_EQ(I, cast<ConstantInt>(GI->getInitializer())->getSExtValue());
+    ++GI;
+    ASSERT_EQ("str" + Suffix(I), GI->getName());
+    EXPECT_EQ(I, cast<ConstantInt>(GI->getInitializer())->getSExtValue());
+    ++GI;
+  }
+  EXPECT_EQ(M->global_end(), GI);
+
+  // The uses of the shared declaration are in function order.
+  int I = 0;
+  for (User *U : M->getFunction("shared")->users())
+    EXPECT_EQ("f" + std::to_string(I++),
+              cast<Instruction>(U)->getFunction()->getName());
+  EXPECT_EQ(NumFunctions, I);
+
+  // New declarations are sorted by name, after the definitions.
+  std::vector<StringRef> Declarations;
+  for (Function &F : *M)
+    if (F.isDeclaration())
+      Declarations.push_back(F.getName());
+  EXPECT_EQ(size_t(NumFunctions + 1), Declarations.size());
+  EXPECT_TRUE(std::is_sorted(Declarations.begin(), Declarations.end()));
+  EXPECT_TRUE(M->getFunctionList().back().isDeclaration());
+}
 }
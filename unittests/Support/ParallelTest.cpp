@@ -15,6 +15,7 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
 #include <random>
 
 uint32_t array[1024 * 1024];
@@ -50,4 +51,16 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, nested_parallel_for) {
+  // Nested loops spawn TaskGroups from worker threads. Waiting workers must
+  // keep running pending tasks, otherwise deep nesting would exhaust the pool.
+  std::atomic<uint32_t> count{0};
+  for_each_n(parallel::par, 0, 64, [&count](size_t I) {
+    for_each_n(parallel::par, 0, 64, [&count](size_t J) {
+      for_each_n(parallel::par, 0, 64, [&count](size_t K) { ++count; });
+    });
+  });
+  ASSERT_EQ(count, 64u * 64u * 64u);
+}
+
 #endif
@@ -164,3 +164,57 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   }
   ASSERT_EQ(5, checked_in);
 }
+
+TEST_F(ThreadPoolTest, GroupWait) {
+  CHECK_UNSUPPORTED();
+  // Test that waiting on a group does not wait on the other tasks.
+  ThreadPool Pool{2};
+  ThreadPoolTaskGroup Group(Pool);
+  std::atomic_int checked_in{0};
+  Pool.async([this, &checked_in] {
+    waitForMainThread();
+    ++checked_in;
+  });
+  for (size_t i = 0; i < 5; ++i)
+    Group.async([&checked_in] { checked_in += 10; });
+  Group.wait();
+  ASSERT_EQ(50, checked_in);
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(51, checked_in);
+}
+
+TEST_F(ThreadPoolTest, GroupPriority) {
+  CHECK_UNSUPPORTED();
+  // Test that queued tasks start in priority order, and in submission order
+  // within a priority.
+  ThreadPool Pool{1};
+  ThreadPoolTaskGroup Group(Pool);
+  std::vector<int> Order;
+  Pool.async([this] { waitForMainThread(); });
+  Group.async([&Order] { Order.push_back(0); }, 0);
+  Group.async([&Order] { Order.push_back(1); }, 2);
+  Group.async([&Order] { Order.push_back(2); }, 1);
+  Group.async([&Order] { Order.push_back(3); }, 2);
+  setMainThreadReady();
+  Group.wait();
+  ASSERT_EQ(std::vector<int>({1, 3, 2, 0}), Order);
+}
+
+TEST_F(ThreadPoolTest, GroupCancel) {
+  CHECK_UNSUPPORTED();
+  // Test that cancelling a group skips its tasks that have not started, and
+  // that their futures still become ready.
+  ThreadPool Pool{1};
+  ThreadPoolTaskGroup Group(Pool);
+  std::atomic_int checked_in{0};
+  Pool.async([this] { waitForMainThread(); });
+  std::shared_future<void> Future =
+      Group.async([&checked_in] { ++checked_in; });
+  Group.cancel();
+  ASSERT_TRUE(Group.isCancelled());
+  setMainThreadReady();
+  Future.wait();
+  Group.wait();
+  ASSERT_EQ(0, checked_in);
+}